@@ -8,6 +8,7 @@
 void bm_add(const char *a, const char *b);
 void bm_sub(const char *a, const char *b);
 void bm_mul(const char *a, const char *b);
+void bm_batch(bool (*op)(bigint **, bigint *const *, bigint *const *, size_t));
 
 char* operands[NOPS] = {
     "82651617193819058094455678710083284493369113095124",
@@ -2028,7 +2029,19 @@ int main() {
   end = clock();
 
   double cpu_time_used = ((double)(end - start)) / CLOCKS_PER_SEC;
-  printf("%.4f\n", cpu_time_used);
+  printf("%s/%s: %.4f\n", BI_LIMB_NAME, bi_kernel_name(), cpu_time_used);
+
+  // the same operations through the batch API
+  start = clock();
+  for (int run = 0; run < NRUNS; run++) {
+    bm_batch(bi_add_n);
+    bm_batch(bi_sub_n);
+    bm_batch(bi_mul_n);
+  }
+  end = clock();
+
+  cpu_time_used = ((double)(end - start)) / CLOCKS_PER_SEC;
+  printf("%s/%s batch: %.4f\n", BI_LIMB_NAME, bi_kernel_name(), cpu_time_used);
 
   return 0;
 }
@@ -2059,3 +2072,20 @@ void bm_mul(const char *a, const char *b) {
   bi_delete(ib);
   bi_delete(ic);
 }
+
+void bm_batch(bool (*op)(bigint **, bigint *const *, bigint *const *, size_t)) {
+  bigint *ia[NOPS / 2];
+  bigint *ib[NOPS / 2];
+  bigint *ic[NOPS / 2];
+  for (int i = 0; i < NOPS / 2; i++) {
+    ia[i] = bi_fromstring(operands[2 * i]);
+    ib[i] = bi_fromstring(operands[2 * i + 1]);
+  }
+  // a failed batch leaves ic untouched
+  if (op(ic, ia, ib, NOPS / 2))
+    bi_delete_n(ic, NOPS / 2);
+  for (int i = 0; i < NOPS / 2; i++) {
+    bi_delete(ia[i]);
+    bi_delete(ib[i]);
+  }
+}
@@ -1,6 +1,122 @@
 #include "bigint.h"
 
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+// the SIMD kernels are written for 32-bit base 10^9 limbs
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+    BI_LIMB_BITS == 32
+#define BI_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+// products of two limbs
+#if BI_LIMB_BITS == 64
+typedef unsigned __int128 bi_dlimb;
+#else
+typedef uint64_t bi_dlimb;
+#endif
+
+// Decimal I/O goes through chunks of BI_CHUNK_DIGITS digits. In the decimal
+// representations a chunk is a limb; binary limbs are converted from and to
+// base 10^19 chunks.
+// limbs of a 64-bit integer
+#if defined(BI_BINARY)
+#define BI_WORD_LIMBS 1
+#elif defined(BI_LIMB_DEC18)
+#define BI_WORD_LIMBS 2
+#else
+#define BI_WORD_LIMBS 3
+#endif
+
+// the limb base as a double limb
+#if defined(BI_BINARY)
+#define BI_RADIX ((bi_dlimb)1 << 64)
+#else
+#define BI_RADIX ((bi_dlimb)BASE)
+#endif
+
+#if defined(BI_BINARY)
+#define BI_CHUNK_DIGITS 19
+#define BI_CHUNK_BASE 10000000000000000000ULL
+#else
+#define BI_CHUNK_DIGITS BI_LIMB_DIGITS
+#define BI_CHUNK_BASE BASE
+#endif
+
 static inline int bi_opposite_sign(const bigint* a, const bigint * b);
+static bigint* bi_alloc(size_t xlen);
+static bigint* bi_normalize(bigint *a);
+static bigint* bi_set_sign(bigint *a, bool positive);
+static bigint* bi_addsub(const bigint *a, const bigint *b, bool bpositive);
+static bigint* bi_muladd(const bigint *c, const bigint *a, const bigint *b,
+                         bool sub);
+static inline int bi_limb_digits(bi_limb t);
+static const char* bi_str(const bigint *a);
+static char* bi_strdup(const char *s, size_t n);
+static bool bi_mul_limbs(bi_limb *r, const bi_limb *a, size_t an,
+                         const bi_limb *b, size_t bn);
+static bool bi_sqr_limbs(bi_limb *r, const bi_limb *a, size_t n);
+static bool bi_mul_parallel(bi_limb *r, const bi_limb *a, size_t an,
+                            const bi_limb *b, size_t bn, size_t width);
+static const bigint* bi_word(bigint *view, bi_limb *x, bool positive,
+                             uint64_t magnitude);
+static bool bi_limbs_to_u64(const bi_limb *x, size_t n, uint64_t *v);
+static inline uint64_t bi_abs64(int64_t v);
+static bigint* bi_pow2(uint64_t e);
+static bigint* bi_pow_abs(const bigint *a, uint64_t n);
+static bool bi_divrem_abs(bigint **q, bigint **r, const bigint *a,
+                          const bigint *d, const bigint *inv);
+#if defined(BI_BINARY)
+// (10^19)^(2^j) and their reciprocals as seen by one conversion: shared
+// entries of the power cache, or its own when the cache is full
+struct bi_powers {
+  bigint* pow[64];
+  bigint* inv[64];
+  uint64_t own_pow;
+  uint64_t own_inv;
+  bool user;  // counted as a user of the cache
+};
+
+static size_t bi_from_chunks(bi_limb *x, const bi_limb *chunks, size_t n);
+static size_t bi_to_chunks(bi_limb *chunks, bi_limb *x, size_t xlen);
+static bigint* bi_from_chunks_dc(const bi_limb *chunks, size_t n,
+                                 struct bi_powers *pw);
+static bool bi_to_chunks_dc(bi_limb *chunks, size_t *n, const bigint *x,
+                            size_t pad, struct bi_powers *pw);
+static void bi_powers_init(struct bi_powers *pw);
+static void bi_powers_free(struct bi_powers *pw);
+#endif
+
+// Kernels selected at startup for the running CPU
+struct bi_kernels {
+  const char *name;
+  int level;
+  bi_limb (*add_n)(bi_limb *, const bi_limb *, const bi_limb *, size_t);
+  bi_limb (*sub_n)(bi_limb *, const bi_limb *, const bi_limb *, size_t);
+  void (*mul)(bi_limb *, const bi_limb *, size_t, const bi_limb *, size_t);
+  // r += a b and r -= a b over an + bn limbs, returning the carry or borrow
+  bi_limb (*addmul)(bi_limb *, const bi_limb *, size_t, const bi_limb *, size_t);
+  bi_limb (*submul)(bi_limb *, const bi_limb *, size_t, const bi_limb *, size_t);
+  // acc[i] += a[i] into double-limb lanes, without carries
+  void (*add_wide)(bi_dlimb *, const bi_limb *, size_t);
+  // n full chunks from n * BI_CHUNK_DIGITS digits, most significant first
+  void (*parse)(bi_limb *, const char *, size_t);
+  // n chunks to zero-padded digits, most significant first
+  void (*format)(char *, const bi_limb *, size_t);
+};
+
+// the selected kernels; bi_kernel_select may switch them while other threads
+// compute, so each call reads the pointer once through bi_kern()
+static const struct bi_kernels* bi_kernel;
+
+static inline const struct bi_kernels* bi_kern(void) {
+  return __atomic_load_n(&bi_kernel, __ATOMIC_ACQUIRE);
+}
 
 bigint* bi_fromstring(const char *str) {
   // verify string format
@@ -21,6 +137,8 @@ bigint* bi_fromstring(const char *str) {
   while (*str == '0')
     str++;
 
+  retval->str = NULL;
+
   // Bigint ZERO
   if (*str == '\0') {
     retval->xlen = 0;
@@ -30,42 +148,39 @@ bigint* bi_fromstring(const char *str) {
     return retval;
   }
 
-  // calculate size of x
+  // calculate size of x (in binary, the chunk count bounds it)
   int digits = (int)strlen(str);
-  int xlen = (digits + 8) / 9;
+  int xlen = (digits + BI_CHUNK_DIGITS - 1) / BI_CHUNK_DIGITS;
 
   // allocate memory for x
-  int *x = malloc(digits * sizeof(int));
+  bi_limb *x = malloc(xlen * sizeof(bi_limb));
   if (!x) {
     free(retval);
     return NULL;
   }
 
-  // initialize content of x
-  int i = digits-1;
-  int at = 1;
-  for (; i >= 8; i -= 9) {
-    at = i/9;
-    x[xlen-at-1] = (str[i-8] - '0') * 100000000
-                 + (str[i-7] - '0') * 10000000
-                 + (str[i-6] - '0') * 1000000
-                 + (str[i-5] - '0') * 100000
-                 + (str[i-4] - '0') * 10000
-                 + (str[i-3] - '0') * 1000
-                 + (str[i-2] - '0') * 100
-                 + (str[i-1] - '0') * 10
-                 + (str[i] - '0');
-  }
+  // initialize content of x: the leading partial chunk, then full chunks
+  int lead = digits - BI_CHUNK_DIGITS * (xlen - 1);
+  bi_limb accum = 0;
+  for (int i = 0; i < lead; i++)
+    accum = accum * 10 + (bi_limb)(str[i] - '0');
+  x[xlen-1] = accum;
+  bi_kern()->parse(x, str + lead, xlen - 1);
 
-  if (at > 0) {
-    int power = 1;
-    int accum = 0;
-    for (; i >= 0; --i) {
-      accum += power * (str[i] - '0');
-      power *= 10;
-    }
-    x[xlen-1] = accum;
+#if defined(BI_BINARY)
+  struct bi_powers pw;
+  bi_powers_init(&pw);
+  bigint* value = bi_from_chunks_dc(x, xlen, &pw);
+  bi_powers_free(&pw);
+  free(x);
+  if (!value) {
+    free(retval);
+    return NULL;
   }
+  x = value->x;
+  xlen = value->xlen;
+  free(value);
+#endif
 
   retval->xlen = xlen;
   retval->x = x;
@@ -77,93 +192,121 @@ bigint* bi_fromstring(const char *str) {
 void bi_delete(bigint* a) {
   if (a) {
     free(a->x);
+    free(a->str);
     free(a);
   }
 }
 
-bigint* bi_add(const bigint *a, const bigint *b) {
-  // One operand is NULL
-  if (!(a && b))
-    return NULL;
+bigint* bi_from_i64(int64_t v) {
+  bigint view;
+  bi_limb x[BI_WORD_LIMBS];
+  return bi_copy(bi_word(&view, x, v >= 0, bi_abs64(v)));
+}
 
-  // One operand is bigint zero
-  if (bi_is_zero(a))
-    return bi_copy(b);
-  if (bi_is_zero(b))
-    return bi_copy(a);
+bigint* bi_from_u64(uint64_t v) {
+  bigint view;
+  bi_limb x[BI_WORD_LIMBS];
+  return bi_copy(bi_word(&view, x, true, v));
+}
 
-  // Allocate memory for bigint
-  bigint* retval = malloc(sizeof(bigint));
-  if (!retval)
+bigint* bi_from_double(double d) {
+  if (isnan(d) || isinf(d))
     return NULL;
 
-  // subtract or add?
-  if (bi_opposite_sign(a, b)) {
-    retval->digits = b->digits;
-    retval->xlen = b->xlen;
-    retval->x = b->x;
-    retval->positive = !(b->positive);
-    bigint* res = bi_sub(a, retval);
-    free(retval);
-    return res;
-  }
+  // |d| = m * 2^e with a 53-bit integer m
+  int e;
+  uint64_t m = (uint64_t)ldexp(frexp(fabs(d), &e), DBL_MANT_DIG);
+  e -= DBL_MANT_DIG;
 
-  // From here on, a and b will have the same sign
-  if (a->digits > b->digits) {
-    const bigint* tmp = a;
-    a = b;
-    b = tmp;
-  }
+  bigint view;
+  bi_limb x[BI_WORD_LIMBS];
+  if (e <= 0)
+    return bi_copy(bi_word(&view, x, !(d < 0), -e < 64 ? m >> -e : 0));
 
-  int* ax = a->x;
-  int* bx = b->x;
-  int axlen = a->xlen;
-  int bxlen = b->xlen;
-  int xlen = bxlen;
+  bigint* p = bi_pow2(e);
+  bigint* retval = bi_mul(p, bi_word(&view, x, !(d < 0), m));
+  bi_delete(p);
+  return retval;
+}
 
-  int *x = malloc((bxlen + 1) * sizeof(int));
-  if (!x) {
-    free(retval);
-    return NULL;
-  }
+bool bi_to_i64(const bigint *a, int64_t *v) {
+  uint64_t m;
+  if (!a || !bi_limbs_to_u64(a->x, a->xlen, &m))
+    return false;
+  if (m > (a->positive ? (uint64_t)INT64_MAX : (uint64_t)INT64_MAX + 1))
+    return false;
 
-  long sum = 0;
-  int i = 0;
-  for (; i < axlen; i++) {
-    sum += (long)ax[i] + (long)bx[i];
-    x[i] = (int)(sum % BASE);
-    sum /= BASE;
-  }
+  if (v)
+    *v = a->positive ? (int64_t)m : (int64_t)(0 - m);
+  return true;
+}
 
-  for (; i < bxlen; i++) {
-    sum += (long)bx[i];
-    x[i] = (int)(sum % BASE);
-    sum /= BASE;
-  }
-  x[i] = (int)sum;
+// The top 60 to 64 bits t of |a| are taken exactly, with the lowest one
+// OR-ed with whatever lies below them. That bit is far under the rounding
+// position of a double, so converting t rounds |a| itself correctly.
+double bi_to_double(const bigint *a) {
+  if (!a)
+    return 0;
 
-  if (sum > 0)
-    xlen++;
+  uint64_t t = 0;
+  if (bi_limbs_to_u64(a->x, a->xlen, &t))
+    return a->positive ? (double)t : -(double)t;
 
-  // calculate number of digits
-  int ndigits;
-  if (xlen == 1) {
-    ndigits = 0;
-    for (int t = x[0]; t >= 1; t /= 10)
-      ++ndigits;
-  } else if (sum) {
-    ndigits = bxlen * 9 + 1;
-  } else {
-    // if b->xlen is a multiple of nine (9, 18...)
-    int mod = b->digits % 9;
-    ndigits = bxlen * 9 + mod - 9 * (mod != 0);
+  int s;  // |a| ~ t * 2^s
+#if defined(BI_BINARY)
+  size_t n = a->xlen;
+  if (n > 16)
+    return a->positive ? HUGE_VAL : -HUGE_VAL;
+
+  int lz = 0;
+  while (!(a->x[n - 1] >> (63 - lz)))
+    lz++;
+  s = (int)(n - 2) * 64 + (64 - lz);
+  t = lz ? (a->x[n - 1] << lz) | (a->x[n - 2] >> (64 - lz)) : a->x[n - 1];
+  bool sticky = (a->x[n - 2] << lz) != 0;
+  for (size_t i = 0; i + 2 < n && !sticky; i++)
+    sticky = a->x[i] != 0;
+#else
+  // DBL_MAX has 309 digits
+  if (bi_digits(a) > 309)
+    return a->positive ? HUGE_VAL : -HUGE_VAL;
+
+  // the bit length to within one, from the leading limbs
+  double approx = 0;
+  for (int i = a->xlen; i-- > 0;)
+    approx = approx * BASE + a->x[i];
+  int e = 1024;
+  if (!isinf(approx))
+    frexp(approx, &e);
+  s = e - 62;
+
+  bigint* p = bi_pow2(s);
+  bigint* q;
+  bigint* r;
+  if (!p || !bi_divrem_abs(&q, &r, a, p, NULL)) {
+    bi_delete(p);
+    return NAN;
   }
-  retval->xlen = xlen;
-  retval->x = x;
-  retval->digits = ndigits;
-  retval->positive = a->positive;
+  bool fits = bi_limbs_to_u64(q->x, q->xlen, &t);
+  bool sticky = !bi_is_zero(r);
+  bi_delete(p);
+  bi_delete(q);
+  bi_delete(r);
+  // only when the estimate was capped, and then |a| >= 2^1026
+  if (!fits)
+    return a->positive ? HUGE_VAL : -HUGE_VAL;
+#endif
 
-  return retval;
+  double retval = ldexp((double)(t | sticky), s);
+  return a->positive ? retval : -retval;
+}
+
+bigint* bi_add(const bigint *a, const bigint *b) {
+  // One operand is NULL
+  if (!(a && b))
+    return NULL;
+
+  return bi_addsub(a, b, b->positive);
 }
 
 bigint* bi_sub(const bigint *a, const bigint *b) {
@@ -171,116 +314,61 @@ bigint* bi_sub(const bigint *a, const bigint *b) {
   if (!(a && b))
     return NULL;
 
+  return bi_addsub(a, b, !b->positive);
+}
+
+// a + (+/-)|b|, where bpositive is the sign b should be treated as having
+static bigint* bi_addsub(const bigint *a, const bigint *b, bool bpositive) {
   bigint* retval;
 
   // One operand is bigint zero
-  if (bi_is_zero(a)) {
-    retval = bi_copy(b);
-    retval->positive = !retval->positive;
-    return retval;
-  }
   if (bi_is_zero(b))
     return bi_copy(a);
-
-  // Cannot allocate memory for bigint
-  retval = malloc(sizeof(bigint));
-  if (!retval)
-    return NULL;
-
-  // if opposite sign then calculate using addition
-  if (bi_opposite_sign(a, b)) {
-    retval->digits = b->digits;
-    retval->xlen = b->xlen;
-    retval->x = b->x;
-    retval->positive = !(b->positive);
-    bigint* res = bi_add(a, retval);
-    free(retval);
-    return res;
-  }
-
-  bool swapped = false;
-  if (!a->positive) {
-    const bigint* tmp = a;
-    a = b;
-    b = tmp;
+  if (bi_is_zero(a)) {
+    return bi_set_sign(bi_copy(b), bpositive);
   }
 
-  if (bi_cmp(a, b) < 0) {
-    const bigint* tmp = a;
-    a = b;
-    b = tmp;
-    swapped = true;
-  }
+  size_t axlen = a->xlen;
+  size_t bxlen = b->xlen;
 
-  int axlen = a->xlen;
-  int bxlen = b->xlen;
-  int* ax = a->x;
-  int* bx = b->x;
-  int xlen = axlen > bxlen ? axlen : bxlen;
+  // same sign: add magnitudes
+  if (a->positive == bpositive) {
+    if (axlen < bxlen) {
+      const bigint* tmp = a;
+      a = b;
+      b = tmp;
+      axlen = a->xlen;
+      bxlen = b->xlen;
+    }
 
-  int* x = malloc(xlen * sizeof(int));
-  if (!x) {
-    free(retval);
-    return NULL;
+    retval = bi_alloc(axlen + 1);
+    if (!retval)
+      return NULL;
+    retval->x[axlen] = bi_limbs_add(retval->x, a->x, axlen, b->x, bxlen);
+    retval->positive = bpositive;
+    return bi_normalize(retval);
   }
 
-  int ia = 0;
-  int ib = 0;
-  int diff = 0;
-  bool zero = true; // is the two operand the same
-  int firstoctet = 0;
-  if (axlen == 1) {
-    diff = ax[0] - bx[0];
-    x[0] = diff;
-    zero = diff == 0;
-  } else {
-    // axlen, bxlen must be at least 1 now
-    while (ia < axlen || ib < bxlen) {
-      if (ia < axlen) {
-        diff += ax[ia];
-        ++ia;
-      }
-      if (ib < bxlen) {
-        diff -= bx[ib];
-        ++ib;
-      }
+  // opposite sign: subtract the smaller magnitude from the larger one
+  int cmp = bi_limbs_cmp(a->x, axlen, b->x, bxlen);
+  if (cmp == 0)
+    return bi_zero();
 
-      if (diff < 0) {
-        x[ia - 1] = diff + BASE;
-        diff = -1;
-      } else {
-        x[ia - 1] = diff % BASE;
-        diff /= BASE;
-      }
-      zero = zero && !x[ia-1];
-      if (x[ia - 1])
-        firstoctet = ia - 1;
-    }
+  if (cmp > 0) {
+    retval = bi_alloc(axlen);
+    if (!retval)
+      return NULL;
+    bi_limbs_sub(retval->x, a->x, axlen, b->x, bxlen);
+    retval->positive = a->positive;
+  } else {
+    retval = bi_alloc(bxlen);
+    if (!retval)
+      return NULL;
+    bi_limbs_sub(retval->x, b->x, bxlen, a->x, axlen);
+    retval->positive = bpositive;
   }
 
-  if (zero) {
-    free(x);
-    retval->x = NULL;
-  } else
-    retval->x = x;
-
-  // TODO: if x is over allocated, resize it
-  if (x[firstoctet] < 0)
-    x[0] = -x[0];
-  // swapped,d >= 0,positive
-  // 0 0 0
-  // 0 1 1
-  // 1 0 1
-  // 1 1 0
-  retval->positive = (diff >= 0) ^ swapped;
-  int ndigits = 9 * firstoctet;
-  for (int t = x[firstoctet]; t >= 1; t /= 10)
-    ++ndigits;
-
-  retval->xlen = firstoctet + 1;
-  retval->digits = ndigits;
-
-  return retval;
+  return bi_normalize(retval);
 }
 
 bigint* bi_mul(const bigint *a, const bigint *b) {
@@ -293,107 +381,236 @@ bigint* bi_mul(const bigint *a, const bigint *b) {
     return bi_zero();
 
   bigint* retval;
-  int* xa = a->x;
-  int* xb = b->x;
-  int alen = a->xlen;
-  int blen = b->xlen;
 
   // One operand is bigint one or minus one
   if (a->x[0] == 1 && a->xlen == 1) {
-    retval = bi_copy(b);
-    retval->positive = !(a->positive ^ b->positive);
-    return retval;
+    return bi_set_sign(bi_copy(b), !(a->positive ^ b->positive));
   }
 
   if (b->x[0] == 1 && b->xlen == 1) {
-    retval = bi_copy(a);
-    retval->positive = !(a->positive ^ b->positive);
-    return retval;
+    return bi_set_sign(bi_copy(a), !(a->positive ^ b->positive));
   }
 
-  // Cannot allocate memory for bigint
-  retval = malloc(sizeof(bigint));
+  size_t alen = a->xlen;
+  size_t blen = b->xlen;
+  retval = bi_alloc(alen + blen);
   if (!retval)
     return NULL;
 
-  int xlen = (a->digits + b->digits + 8) / 9;
-  int* x = calloc(xlen, sizeof(int));
-  if (!x) {
-    free(retval);
+  if (!bi_mul_parallel(retval->x, a->x, alen, b->x, blen, 1)) {
+    bi_delete(retval);
     return NULL;
   }
 
-  // Long multiplication
-  long product;
-  for (int ib = 0; ib < blen; ib++) {
-    product = 0L;
-    for (int ia = 0; ia < alen; ia++) {
-      product += (long)xa[ia] * (long)xb[ib] + (long)x[ia + ib];
-      x[ia + ib] = (int)(product % BASE);
-      product /= BASE;
-    }
-    x[ib + alen] += product;
-  }
+  retval->positive = !(a->positive ^ b->positive);
+  return bi_normalize(retval);
+}
 
-  // find xlen and digits
-  int lastnonzeroindex = xlen - 1;
-  while (x[lastnonzeroindex] == 0)
-    lastnonzeroindex--;
-  int ndigits = 9 * lastnonzeroindex;
-  for (int t = x[lastnonzeroindex]; t >= 1; t /= 10)
-    ++ndigits;
+bigint* bi_addmul(const bigint *c, const bigint *a, const bigint *b) {
+  return bi_muladd(c, a, b, false);
+}
 
-  retval->positive = !(a->positive ^ b->positive);
-  retval->digits = ndigits;
-  retval->xlen = lastnonzeroindex + 1;
-  retval->x = x;
-  return retval;
+bigint* bi_submul(const bigint *c, const bigint *a, const bigint *b) {
+  return bi_muladd(c, a, b, true);
 }
 
 bigint* bi_div(const bigint *a, const bigint *b) {
-  return NULL;
+  // One operand is NULL, or division by zero
+  if (!(a && b) || bi_is_zero(b))
+    return NULL;
+
+  bigint* q;
+  bigint* r;
+  if (!bi_divrem_abs(&q, &r, a, b, NULL))
+    return NULL;
+  bi_delete(r);
+
+  // the quotient is rounded toward zero
+  return bi_set_sign(q, bi_is_zero(q) || a->positive == b->positive);
 }
 
-bigint* bi_factorial(const bigint *a) {
+bigint* bi_pow(const bigint *a, uint64_t n) {
   if (!a)
     return NULL;
 
-  bigint* one = bi_fromstring("1");
+  bigint view;
+  bi_limb x[BI_WORD_LIMBS];
+  if (n == 0)
+    return bi_copy(bi_word(&view, x, true, 1));
+  if (n == 1 || bi_is_zero(a))
+    return bi_copy(a);
+  if (a->xlen == 1 && a->x[0] == 1)
+    return bi_set_sign(bi_copy(a), a->positive || n % 2 == 0);
 
-  if (bi_is_zero(a))
-    return one;
+  return bi_set_sign(bi_pow_abs(a, n), a->positive || n % 2 == 0);
+}
+
+bigint* bi_add_si(const bigint *a, int64_t b) {
+  if (!a)
+    return NULL;
+
+  bigint view;
+  bi_limb x[BI_WORD_LIMBS];
+  return bi_addsub(a, bi_word(&view, x, b >= 0, bi_abs64(b)), b >= 0);
+}
+
+bigint* bi_sub_si(const bigint *a, int64_t b) {
+  if (!a)
+    return NULL;
+
+  bigint view;
+  bi_limb x[BI_WORD_LIMBS];
+  return bi_addsub(a, bi_word(&view, x, b >= 0, bi_abs64(b)), b < 0);
+}
+
+bigint* bi_mul_si(const bigint *a, int64_t b) {
+  if (!a)
+    return NULL;
 
-  if (!a->positive) {
-    bi_delete(one);
+  bigint view;
+  bi_limb x[BI_WORD_LIMBS];
+  return bi_mul(a, bi_word(&view, x, b >= 0, bi_abs64(b)));
+}
+
+bigint* bi_divmod_si(const bigint *a, int64_t b, int64_t *r) {
+  // NULL operand, or division by zero
+  if (!a || b == 0)
     return NULL;
+
+  uint64_t d = bi_abs64(b);
+  uint64_t rem = 0;
+  bigint* q;
+  if (bi_is_zero(a))
+    q = bi_zero();
+  else if (d <= BI_LIMB_MAX) {
+    // a single pass over the limbs
+    q = bi_alloc(a->xlen);
+    if (!q)
+      return NULL;
+    rem = bi_limbs_divrem_1(q->x, a->x, a->xlen, (bi_limb)d);
+    bi_normalize(q);
+  } else {
+    bigint view;
+    bi_limb x[BI_WORD_LIMBS];
+    bigint* rb;
+    if (!bi_divrem_abs(&q, &rb, a, bi_word(&view, x, true, d), NULL))
+      return NULL;
+    bi_limbs_to_u64(rb->x, rb->xlen, &rem);
+    bi_delete(rb);
   }
 
-  bigint* newretval;
-  bigint* newprev;
-  bigint* retval = bi_copy(one);
-  bigint* prev = bi_copy(a);
+  // truncated division: the remainder takes the sign of a
+  if (r)
+    *r = a->positive ? (int64_t)rem : -(int64_t)rem;
+  return bi_set_sign(q, bi_is_zero(q) || a->positive == (b > 0));
+}
 
-  if (!retval)
+bigint* bi_factorial(const bigint *a) {
+  if (!a || !a->positive)
     return NULL;
 
-  // TODO: is it better if we use mutable bigint here?
+  // n! for n beyond a machine word would not fit in memory anyway
+  uint64_t n;
+  if (!bi_limbs_to_u64(a->x, a->xlen, &n) || n > INT64_MAX)
+    return NULL;
 
-  while (!bi_is_zero(prev)) {
-    newretval = bi_mul(retval, prev);
+  bigint view;
+  bi_limb x[BI_WORD_LIMBS];
+  bigint* retval = bi_copy(bi_word(&view, x, true, 1));
+  for (uint64_t k = 2; k <= n && retval; k++) {
+    bigint* next = bi_mul_si(retval, (int64_t)k);
     bi_delete(retval);
-    if (!retval)
-      return NULL;
-    retval = newretval;
+    retval = next;
+  }
 
-    newprev = bi_sub(prev, one);
-    bi_delete(prev);
-    if (!prev)
-      return NULL;
-    prev = newprev;
+  return retval;
+}
+
+char* bi_tostring(const bigint* a) {
+  if (!a)
+    return NULL;
+
+  const char* str = bi_str(a);
+  if (!str)
+    return NULL;
+  return bi_strdup(str, strlen(str));
+}
+
+// keeps str with a unless another thread got there first, in which case
+// that thread's string is the one returned
+static const char* bi_str_publish(const bigint *a, char *str) {
+  char* cached = NULL;
+  if (str && !__atomic_compare_exchange_n(&((bigint *)a)->str, &cached, str,
+                                          false, __ATOMIC_ACQ_REL,
+                                          __ATOMIC_ACQUIRE)) {
+    free(str);
+    return cached;
+  }
+  return str;
+}
+
+// decimal form of a, formatted on first use and kept with the bigint
+static const char* bi_str(const bigint *a) {
+  const char* cached = __atomic_load_n(&a->str, __ATOMIC_ACQUIRE);
+  if (cached)
+    return cached;
+
+  if (!a->x)
+    return bi_str_publish(a, bi_strdup("0", 1));
+
+  size_t n = a->xlen;
+  const bi_limb* chunks = a->x;
+#if defined(BI_BINARY)
+  // 64 bits hold a little more than 19 digits
+  bi_limb* tmp = malloc((n + n / 32 + 1) * sizeof(bi_limb));
+  struct bi_powers pw;
+  bi_powers_init(&pw);
+  bool ok = tmp && bi_to_chunks_dc(tmp, &n, a, 0, &pw);
+  bi_powers_free(&pw);
+  if (!ok) {
+    free(tmp);
+    return NULL;
+  }
+  chunks = tmp;
+#endif
+
+  char* retval = malloc(n * BI_CHUNK_DIGITS + 2);
+  if (retval) {
+    char* out = retval;
+    if (!a->positive)
+      *out++ = '-';
+
+    // leading chunk without padding, then zero-padded chunks
+    char lead[BI_CHUNK_DIGITS + 1];
+    int nlead = 0;
+    for (bi_limb t = chunks[n - 1]; t; t /= 10)
+      lead[nlead++] = (char)('0' + t % 10);
+    while (nlead > 0)
+      *out++ = lead[--nlead];
+
+    bi_kern()->format(out, chunks, n - 1);
+    out += BI_CHUNK_DIGITS * (n - 1);
+    *out = '\0';
+
+#if defined(BI_BINARY)
+    // the only build that caches the count for bi_digits()
+    __atomic_store_n(&((bigint *)a)->digits,
+                     (int)(out - retval) - !a->positive, __ATOMIC_RELAXED);
+#endif
   }
 
-  bi_delete(prev);
+#if defined(BI_BINARY)
+  free(tmp);
+#endif
+  return bi_str_publish(a, retval);
+}
 
+static char* bi_strdup(const char *s, size_t n) {
+  char* retval = malloc(n + 1);
+  if (retval) {
+    memcpy(retval, s, n);
+    retval[n] = '\0';
+  }
   return retval;
 }
 
@@ -409,13 +626,18 @@ void bi_print(const bigint* a) {
   }
 
   int xlen = a->xlen;
-  int* x = a->x;
+  bi_limb* x = a->x;
   char sign = a->positive ? ' ' : '-';
 
-  printf("xlen,digits: %4d, %4d, %c", xlen, a->digits, sign);
-  printf("%d ", x[xlen-1]);
+  printf("xlen,digits: %4d, %4d, %c", xlen, bi_digits(a), sign);
+#if defined(BI_BINARY)
+  for (int i = xlen - 1; i >= 0; --i)
+    printf("%016llx ", (unsigned long long)x[i]);
+#else
+  printf("%llu ", (unsigned long long)x[xlen-1]);
   for (int i = xlen - 2; i >= 0; --i)
-    printf("%09d ", x[i]);
+    printf("%0*llu ", BI_LIMB_DIGITS, (unsigned long long)x[i]);
+#endif
   printf("\n");
 }
 
@@ -430,11 +652,11 @@ int bi_cmp(const bigint *a, const bigint *b) {
   if (b == NULL)
     return 1;
 
-  int adigits = a->digits;
-  int bdigits = b->digits;
+  int axlen = a->xlen;
+  int bxlen = b->xlen;
   bool apositive = a->positive;
-  int* ax = a->x;
-  int* bx = b->x;
+  bi_limb* ax = a->x;
+  bi_limb* bx = b->x;
 
   // one of two operands is zero
   if (ax == NULL) {
@@ -444,6 +666,8 @@ int bi_cmp(const bigint *a, const bigint *b) {
       return -1;
     return 1;
   }
+  if (bx == NULL)
+    return apositive ? 1 : -1;
 
   // opposite sign
   if (apositive ^ b->positive)
@@ -451,14 +675,14 @@ int bi_cmp(const bigint *a, const bigint *b) {
 
   // same sign
 
-  // different number of digits
-  if (adigits < bdigits)
+  // different number of limbs
+  if (axlen < bxlen)
     return apositive ? -1 : 1;
-  if (adigits > bdigits)
+  if (axlen > bxlen)
     return apositive ? 1 : -1;
 
-  // same number of digits
-  for (int i = a->xlen - 1; i >= 0; --i) {
+  // same number of limbs
+  for (int i = axlen - 1; i >= 0; --i) {
     if (ax[i] < bx[i])
       return apositive ? -1 : 1;
     else if (ax[i] > bx[i])
@@ -468,6 +692,61 @@ int bi_cmp(const bigint *a, const bigint *b) {
   return 0;
 }
 
+#if defined(BI_BINARY)
+// floor(k log10(2)) lies between the two results, k log10(2) being rounded
+// down and up in 64-bit fixed point
+static void bi_log10_pow2(uint64_t k, uint64_t *lo, uint64_t *hi) {
+  const uint64_t log10_2 = 0x4D104D427DE7FBCCULL;  // floor(log10(2) 2^64)
+  *lo = (uint64_t)(((bi_dlimb)k * log10_2) >> 64);
+  *hi = (uint64_t)(((bi_dlimb)k * (log10_2 + 1)) >> 64);
+}
+
+// digits of a nonzero a from its bit length: 2^(bits-1) <= |a| < 2^bits,
+// and only when a power of 10 may lie in that range is |a| compared with it;
+// -1 if out of memory
+static int bi_digits_binary(const bigint *a) {
+  size_t n = a->xlen;
+  if (n == 1)
+    return bi_limb_digits(a->x[0]);
+
+  uint64_t bits = 64 * (uint64_t)n - (uint64_t)__builtin_clzll(a->x[n - 1]);
+  uint64_t lo, hi, unused;
+  bi_log10_pow2(bits - 1, &lo, &unused);
+  bi_log10_pow2(bits, &unused, &hi);
+  for (uint64_t d = hi; d > lo; d--) {
+    bigint view;
+    bi_limb x[1];
+    bigint* p = bi_pow_abs(bi_word(&view, x, true, 10), d);
+    if (!p)
+      return -1;
+    int cmp = bi_limbs_cmp(a->x, n, p->x, p->xlen);
+    bi_delete(p);
+    if (cmp >= 0)
+      return (int)d + 1;
+  }
+  return (int)lo + 1;
+}
+#endif
+
+int bi_digits(const bigint *a) {
+  if (!a || !a->x)
+    return 0;
+
+#if defined(BI_BINARY)
+  // bigints are immutable, so the count is cached on first use; other
+  // threads may be reading the same bigint
+  int digits = __atomic_load_n(&a->digits, __ATOMIC_RELAXED);
+  if (digits < 0) {
+    digits = bi_digits_binary(a);
+    if (digits > 0)
+      __atomic_store_n(&((bigint *)a)->digits, digits, __ATOMIC_RELAXED);
+  }
+  return digits;
+#else
+  return BI_LIMB_DIGITS * (a->xlen - 1) + bi_limb_digits(a->x[a->xlen - 1]);
+#endif
+}
+
 bool bi_equal(const bigint *a, const bigint *b) {
   return bi_cmp(a, b) == 0;
 }
@@ -482,6 +761,7 @@ bigint* bi_copy(const bigint* a) {
 
   int xlen = a->xlen;
 
+  retval->str = NULL;
   if (a->x == NULL) {
     retval->xlen = 0;
     retval->digits = 0;
@@ -490,15 +770,15 @@ bigint* bi_copy(const bigint* a) {
     return retval;
   }
 
-  int* x = malloc(xlen * sizeof(int));
+  bi_limb* x = malloc(xlen * sizeof(bi_limb));
   if (!x) {
     free(retval);
     return NULL;
   }
 
-  memcpy(x, a->x, xlen * sizeof(int));
+  memcpy(x, a->x, xlen * sizeof(bi_limb));
   retval->xlen = xlen;
-  retval->digits = a->digits;
+  retval->digits = __atomic_load_n(&a->digits, __ATOMIC_RELAXED);
   retval->positive = a->positive;
   retval->x = x;
 
@@ -526,7 +806,10 @@ bigint* bi_zero() {
   if (!retval)
     return NULL;
   retval->x = NULL;
+  retval->xlen = 0;
+  retval->digits = 0;
   retval->positive = true;
+  retval->str = NULL;
   return retval;
 }
 
@@ -538,22 +821,4495 @@ bigint* bi_negate(const bigint* a) {
   if (!retval)
     return NULL;
 
+  retval->str = NULL;
   if (bi_is_zero(a)) {
     retval->x = NULL;
+    retval->xlen = 0;
+    retval->digits = 0;
     retval->positive = true;
     return retval;
   }
 
-  int *x = malloc(a->xlen * sizeof(int));
+  bi_limb *x = malloc(a->xlen * sizeof(bi_limb));
   if (!x) {
     free(retval);
     return NULL;
   }
 
-  memcpy(x, a->x, a->xlen * sizeof(int));
+  memcpy(x, a->x, a->xlen * sizeof(bi_limb));
   retval->x = x;
   retval->xlen = a->xlen;
-  retval->digits = a->digits;
+  retval->digits = __atomic_load_n(&a->digits, __ATOMIC_RELAXED);
   retval->positive = !a->positive;
   return retval;
 }
+
+// allocate a bigint with room for xlen limbs; the sign is set by the caller
+// and the limb count by bi_normalize once the limbs are filled in
+static bigint* bi_alloc(size_t xlen) {
+  bigint* retval = malloc(sizeof(bigint));
+  if (!retval)
+    return NULL;
+
+  retval->x = malloc(xlen * sizeof(bi_limb));
+  if (!retval->x) {
+    free(retval);
+    return NULL;
+  }
+  retval->xlen = (int)xlen;
+  retval->positive = true;
+  retval->str = NULL;
+  return retval;
+}
+
+// give a copy its sign, dropping a cached string that no longer matches
+static bigint* bi_set_sign(bigint *a, bool positive) {
+  if (a && a->positive != positive) {
+    a->positive = positive;
+    free(a->str);
+    a->str = NULL;
+  }
+  return a;
+}
+
+// Machine words
+//
+// A 64-bit integer takes at most BI_WORD_LIMBS limbs, so word operands are
+// viewed as bigints on the stack and go through the regular paths without
+// allocating.
+static const bigint* bi_word(bigint *view, bi_limb *x, bool positive,
+                             uint64_t magnitude) {
+  size_t n = 0;
+#if defined(BI_BINARY)
+  if (magnitude)
+    x[n++] = magnitude;
+#else
+  for (; magnitude; magnitude /= BASE)
+    x[n++] = (bi_limb)(magnitude % BASE);
+#endif
+  view->positive = positive || n == 0;
+  view->digits = -1;
+  view->xlen = (int)n;
+  view->x = n ? x : NULL;
+  view->str = NULL;
+  return view;
+}
+
+// value of n limbs, false if it does not fit in 64 bits
+static bool bi_limbs_to_u64(const bi_limb *x, size_t n, uint64_t *v) {
+  uint64_t value = 0;
+  for (size_t i = n; i-- > 0;) {
+#if defined(BI_BINARY)
+    if (value)
+      return false;
+    value = x[i];
+#else
+    if (value > (UINT64_MAX - x[i]) / BASE)
+      return false;
+    value = value * BASE + x[i];
+#endif
+  }
+  *v = value;
+  return true;
+}
+
+static inline uint64_t bi_abs64(int64_t v) {
+  return v < 0 ? -(uint64_t)v : (uint64_t)v;
+}
+
+// 2^e
+static bigint* bi_pow2(uint64_t e) {
+#if defined(BI_BINARY)
+  if (e / 64 >= INT_MAX)
+    return NULL;
+  bigint* retval = bi_alloc(e / 64 + 1);
+  if (!retval)
+    return NULL;
+  memset(retval->x, 0, (e / 64) * sizeof(bi_limb));
+  retval->x[e / 64] = (bi_limb)1 << (e % 64);
+  retval->digits = -1;
+  return retval;
+#else
+  bigint view;
+  bi_limb x[BI_WORD_LIMBS];
+  return bi_pow(bi_word(&view, x, true, 2), e);
+#endif
+}
+
+// strip leading zero limbs; digits is left to be computed on demand
+static bigint* bi_normalize(bigint *a) {
+  size_t xlen = bi_limbs_normalize(a->x, a->xlen);
+
+  if (xlen == 0) {
+    free(a->x);
+    a->x = NULL;
+    a->xlen = 0;
+    a->digits = 0;
+    a->positive = true;
+    return a;
+  }
+
+  a->xlen = (int)xlen;
+  a->digits = -1;
+  return a;
+}
+
+// number of decimal digits of a non-zero limb, from its bit length
+static inline int bi_limb_digits(bi_limb t) {
+  static const uint64_t pow10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+    10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+    100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+  };
+
+  // 1233 / 4096 ~ log10(2)
+#if BI_LIMB_BITS == 64
+  int bits = 64 - __builtin_clzll(t);
+#else
+  int bits = 32 - __builtin_clz(t);
+#endif
+  int n = (bits * 1233) >> 12;
+  return n + (t >= pow10[n]);
+}
+
+// Limb arithmetic
+//
+// In the decimal representations limbs stay far below 2^(BI_LIMB_BITS - 1),
+// so carries are found by comparing with BASE and borrows from the sign bit
+// of the wrapped difference. Binary limbs use the wraparound itself.
+
+// r = a + b + carry, returning the carry out
+static inline bi_limb bi_addc(bi_limb *r, bi_limb a, bi_limb b, bi_limb carry) {
+#if defined(BI_BINARY)
+  bi_limb sum = a + b;
+  bi_limb c = sum < a;
+  *r = sum + carry;
+  return c | (*r < sum);
+#else
+  bi_limb sum = a + b + carry;
+  bi_limb c = sum >= BASE;
+  *r = sum - (BASE & -c);
+  return c;
+#endif
+}
+
+// r = a - b - borrow, returning the borrow out
+static inline bi_limb bi_subb(bi_limb *r, bi_limb a, bi_limb b, bi_limb borrow) {
+#if defined(BI_BINARY)
+  bi_limb diff = a - b;
+  bi_limb c = a < b;
+  *r = diff - borrow;
+  return c | (diff < borrow);
+#else
+  bi_limb diff = a - b - borrow;
+  bi_limb c = diff >> (BI_LIMB_BITS - 1);
+  *r = diff + (BASE & -c);
+  return c;
+#endif
+}
+
+#if BI_LIMB_BITS == 64
+// Division of a two-limb number by a limb using a precomputed reciprocal
+// (Moller & Granlund, "Improved division by invariant integers"). d must be
+// normalized (top bit set) and u1 < d.
+static inline bi_limb bi_invert_limb(bi_limb d) {
+  return (bi_limb)(~(bi_dlimb)0 / d);
+}
+
+static inline bi_limb bi_div21(bi_limb *r, bi_limb u1, bi_limb u0,
+                               bi_limb d, bi_limb v) {
+  bi_dlimb q = (bi_dlimb)v * u1 + (((bi_dlimb)u1 << 64) | u0);
+  bi_limb q1 = (bi_limb)(q >> 64) + 1;
+  bi_limb q0 = (bi_limb)q;
+  bi_limb rem = u0 - q1 * d;
+  if (rem > q0) {
+    q1--;
+    rem += d;
+  }
+  if (rem >= d) {
+    q1++;
+    rem -= d;
+  }
+  *r = rem;
+  return q1;
+}
+#endif
+
+#if defined(BI_LIMB_DEC18)
+// 10^18 normalized for bi_div21, and its reciprocal
+#define BI_BASE_SHIFT 4
+#define BI_BASE_NORM 0xde0b6b3a76400000ULL
+#define BI_BASE_INV 0x2725dd1d243aba0eULL
+#endif
+
+// split p < BASE^2 into p / BASE, which is returned, and p % BASE
+static inline bi_limb bi_split(bi_dlimb p, bi_limb *lo) {
+#if defined(BI_BINARY)
+  *lo = (bi_limb)p;
+  return (bi_limb)(p >> 64);
+#elif defined(BI_LIMB_DEC18)
+  // a 128-bit division would be a library call
+  p <<= BI_BASE_SHIFT;
+  bi_limb hi = bi_div21(lo, (bi_limb)(p >> 64), (bi_limb)p,
+                        BI_BASE_NORM, BI_BASE_INV);
+  *lo >>= BI_BASE_SHIFT;
+  return hi;
+#else
+  bi_limb hi = (bi_limb)(p / BASE);
+  *lo = (bi_limb)(p - (bi_dlimb)hi * BASE);
+  return hi;
+#endif
+}
+
+#if !defined(BI_BINARY)
+// split any p into p / BASE, which is returned, and p % BASE
+static inline bi_dlimb bi_split_wide(bi_dlimb p, bi_limb *lo) {
+#if defined(BI_LIMB_DEC18)
+  bi_limb high = (bi_limb)(p >> 64);
+  bi_limb qhigh = high / BASE;
+  // rest < BASE * 2^64, which bi_split still handles
+  bi_dlimb rest = (bi_dlimb)(high - qhigh * BASE) << 64 | (bi_limb)p;
+  return (bi_dlimb)qhigh << 64 | bi_split(rest, lo);
+#else
+  bi_dlimb hi = p / BASE;
+  *lo = (bi_limb)(p - hi * BASE);
+  return hi;
+#endif
+}
+#endif
+
+// Magnitude kernels
+
+int bi_limbs_cmp(const bi_limb *a, size_t an, const bi_limb *b, size_t bn) {
+  an = bi_limbs_normalize(a, an);
+  bn = bi_limbs_normalize(b, bn);
+  if (an != bn)
+    return an < bn ? -1 : 1;
+
+  while (an-- > 0) {
+    if (a[an] != b[an])
+      return a[an] < b[an] ? -1 : 1;
+  }
+  return 0;
+}
+
+size_t bi_limbs_normalize(const bi_limb *a, size_t n) {
+  while (n > 0 && a[n - 1] == 0)
+    --n;
+  return n;
+}
+
+bi_limb bi_limbs_add_1(bi_limb *r, const bi_limb *a, size_t n, bi_limb b) {
+  bi_limb carry = b;
+  size_t i = 0;
+  if (n > 0) {
+    carry = bi_addc(&r[0], a[0], b, 0);
+    i = 1;
+  }
+  for (; i < n && carry; i++)
+    carry = bi_addc(&r[i], a[i], 0, carry);
+  if (r != a)
+    memcpy(r + i, a + i, (n - i) * sizeof(bi_limb));
+  return carry;
+}
+
+bi_limb bi_limbs_add_n(bi_limb *r, const bi_limb *a, const bi_limb *b, size_t n) {
+  return bi_kern()->add_n(r, a, b, n);
+}
+
+bi_limb bi_limbs_add(bi_limb *r, const bi_limb *a, size_t an,
+                     const bi_limb *b, size_t bn) {
+  bi_limb carry = bi_kern()->add_n(r, a, b, bn);
+  return bi_limbs_add_1(r + bn, a + bn, an - bn, carry);
+}
+
+bi_limb bi_limbs_sub_1(bi_limb *r, const bi_limb *a, size_t n, bi_limb b) {
+  bi_limb borrow = b;
+  size_t i = 0;
+  if (n > 0) {
+    borrow = bi_subb(&r[0], a[0], b, 0);
+    i = 1;
+  }
+  for (; i < n && borrow; i++)
+    borrow = bi_subb(&r[i], a[i], 0, borrow);
+  if (r != a)
+    memcpy(r + i, a + i, (n - i) * sizeof(bi_limb));
+  return borrow;
+}
+
+bi_limb bi_limbs_sub_n(bi_limb *r, const bi_limb *a, const bi_limb *b, size_t n) {
+  return bi_kern()->sub_n(r, a, b, n);
+}
+
+bi_limb bi_limbs_sub(bi_limb *r, const bi_limb *a, size_t an,
+                     const bi_limb *b, size_t bn) {
+  bi_limb borrow = bi_kern()->sub_n(r, a, b, bn);
+  return bi_limbs_sub_1(r + bn, a + bn, an - bn, borrow);
+}
+
+bi_limb bi_limbs_mul_1(bi_limb *r, const bi_limb *a, size_t n, bi_limb b) {
+  bi_limb carry = 0;
+  for (size_t i = 0; i < n; i++)
+    carry = bi_split((bi_dlimb)a[i] * b + carry, &r[i]);
+  return carry;
+}
+
+bi_limb bi_limbs_addmul_1(bi_limb *r, const bi_limb *a, size_t n, bi_limb b) {
+  bi_limb carry = 0;
+  for (size_t i = 0; i < n; i++)
+    carry = bi_split((bi_dlimb)a[i] * b + r[i] + carry, &r[i]);
+  return carry;
+}
+
+bi_limb bi_limbs_submul_1(bi_limb *r, const bi_limb *a, size_t n, bi_limb b) {
+  bi_limb carry = 0;
+  for (size_t i = 0; i < n; i++) {
+    bi_limb lo;
+    carry = bi_split((bi_dlimb)a[i] * b + carry, &lo);
+    carry += bi_subb(&r[i], r[i], lo, 0);
+  }
+  return carry;
+}
+
+bi_limb bi_limbs_divrem_1(bi_limb *q, const bi_limb *a, size_t n, bi_limb d) {
+  bi_limb rem = 0;
+#if BI_LIMB_BITS == 64
+  // rem * BASE + a[i] < d * 2^64, so shifting it to match the normalized
+  // divisor keeps it in two limbs with the high one below the divisor
+  int shift = __builtin_clzll(d);
+  bi_limb dn = d << shift;
+  bi_limb v = bi_invert_limb(dn);
+  for (size_t i = n; i-- > 0;) {
+#if defined(BI_BINARY)
+    bi_dlimb u = ((bi_dlimb)rem << 64 | a[i]) << shift;
+#else
+    bi_dlimb u = ((bi_dlimb)rem * BASE + a[i]) << shift;
+#endif
+    q[i] = bi_div21(&rem, (bi_limb)(u >> 64), (bi_limb)u, dn, v);
+    rem >>= shift;
+  }
+#else
+  for (size_t i = n; i-- > 0;) {
+    bi_dlimb u = (bi_dlimb)rem * BASE + a[i];
+    q[i] = (bi_limb)(u / d);
+    rem = (bi_limb)(u - (bi_dlimb)q[i] * d);
+  }
+#endif
+  return rem;
+}
+
+void bi_limbs_mul(bi_limb *r, const bi_limb *a, size_t an,
+                  const bi_limb *b, size_t bn) {
+  bi_kern()->mul(r, a, an, b, bn);
+}
+
+bi_limb bi_limbs_addmul(bi_limb *r, const bi_limb *a, size_t an,
+                        const bi_limb *b, size_t bn) {
+  return bi_kern()->addmul(r, a, an, b, bn);
+}
+
+bi_limb bi_limbs_submul(bi_limb *r, const bi_limb *a, size_t an,
+                        const bi_limb *b, size_t bn) {
+  return bi_kern()->submul(r, a, an, b, bn);
+}
+
+// Karatsuba multiplication
+//
+// Below BI_KARATSUBA_THRESHOLD limbs the long multiplication kernel wins.
+// Above it, a = a1 B^h + a0 and b = b1 B^h + b0 are multiplied with three
+// products of half the size:
+//   ab = z2 B^2h + ((a0 + a1)(b0 + b1) - z2 - z0) B^h + z0
+// where z0 = a0 b0 and z2 = a1 b1. When b is at most half as long as a, a is
+// multiplied by b a piece of b's length at a time.
+#if defined(BI_BINARY)
+#define BI_KARATSUBA_THRESHOLD 24
+#else
+#define BI_KARATSUBA_THRESHOLD 40
+#endif
+
+// scratch limbs used by bi_mul_karatsuba for an >= bn
+static size_t bi_mul_tmp_size(size_t an, size_t bn) {
+  // each level keeps the two sums and their product, 4 (h + 1) limbs, and
+  // recurses on h + 1 limbs; the piecewise case adds a 2 bn limb product
+  size_t size = 2 * bn;
+  while (an >= BI_KARATSUBA_THRESHOLD) {
+    size_t h = (an + 1) / 2;
+    size += 4 * (h + 1);
+    an = h + 1;
+  }
+  return size;
+}
+
+static void bi_mul_karatsuba(bi_limb *r, const bi_limb *a, size_t an,
+                             const bi_limb *b, size_t bn, bi_limb *tmp) {
+  if (bn < BI_KARATSUBA_THRESHOLD) {
+    bi_kern()->mul(r, a, an, b, bn);
+    return;
+  }
+
+  size_t h = (an + 1) / 2;
+  if (bn <= h) {
+    bi_limb* piece = tmp;
+    bi_mul_karatsuba(r, a, bn, b, bn, tmp + 2 * bn);
+    memset(r + 2 * bn, 0, (an - bn) * sizeof(bi_limb));
+    for (size_t i = bn; i < an; i += bn) {
+      size_t n = an - i < bn ? an - i : bn;
+      bi_mul_karatsuba(piece, b, bn, a + i, n, tmp + 2 * bn);
+      bi_limbs_add(r + i, r + i, an + bn - i, piece, n + bn);
+    }
+    return;
+  }
+
+  size_t a1n = an - h;
+  size_t b1n = bn - h;
+  bi_mul_karatsuba(r, a, h, b, h, tmp);
+  bi_mul_karatsuba(r + 2 * h, a + h, a1n, b + h, b1n, tmp);
+
+  bi_limb* sa = tmp;
+  bi_limb* sb = tmp + h + 1;
+  bi_limb* z1 = tmp + 2 * (h + 1);
+  sa[h] = bi_limbs_add(sa, a, h, a + h, a1n);
+  sb[h] = bi_limbs_add(sb, b, h, b + h, b1n);
+  bi_mul_karatsuba(z1, sa, h + 1, sb, h + 1, tmp + 4 * (h + 1));
+  bi_limbs_sub(z1, z1, 2 * h + 2, r, 2 * h);
+  bi_limbs_sub(z1, z1, 2 * h + 2, r + 2 * h, a1n + b1n);
+
+  // a0 b1 + a1 b0 fits above B^h
+  size_t zn = bi_limbs_normalize(z1, 2 * h + 2);
+  bi_limbs_add(r + h, r + h, an + bn - h, z1, zn);
+}
+
+// r = a b for an >= bn, r not overlapping a or b; false if out of memory
+static bool bi_mul_limbs(bi_limb *r, const bi_limb *a, size_t an,
+                         const bi_limb *b, size_t bn) {
+  if (bn == 1) {
+    r[an] = bi_limbs_mul_1(r, a, an, b[0]);
+    return true;
+  }
+  if (bn < BI_KARATSUBA_THRESHOLD) {
+    bi_kern()->mul(r, a, an, b, bn);
+    return true;
+  }
+
+  bi_limb* tmp = malloc(bi_mul_tmp_size(an, bn) * sizeof(bi_limb));
+  if (!tmp)
+    return false;
+  bi_mul_karatsuba(r, a, an, b, bn, tmp);
+  free(tmp);
+  return true;
+}
+
+// Multiply-add
+//
+// c + a b for short products is one pass of the long multiplication kernel
+// over a copy of c: the rows are folded into c's limbs as they are formed,
+// with no product of their own. When the product has the other sign and
+// outweighs c, the result wraps around B^n and is negated back. Products of
+// Karatsuba size cost far more than the sum, so they are formed on their own.
+
+// c + a b, or c - a b with sub
+static bigint* bi_muladd(const bigint *c, const bigint *a, const bigint *b,
+                         bool sub) {
+  // One operand is NULL
+  if (!(a && b && c))
+    return NULL;
+
+  if (bi_is_zero(a) || bi_is_zero(b))
+    return bi_copy(c);
+  bool ppositive = (a->positive == b->positive) != sub;
+  if (bi_is_zero(c))
+    return bi_set_sign(bi_mul(a, b), ppositive);
+
+  if (a->xlen < b->xlen) {
+    const bigint* tmp = a;
+    a = b;
+    b = tmp;
+  }
+  size_t an = a->xlen;
+  size_t bn = b->xlen;
+  size_t cn = c->xlen;
+  if (bn >= BI_KARATSUBA_THRESHOLD) {
+    bigint* p = bi_mul(a, b);
+    bigint* retval = p ? bi_addsub(c, p, ppositive) : NULL;
+    bi_delete(p);
+    return retval;
+  }
+
+  size_t n = (cn > an + bn ? cn : an + bn) + 1;
+  bigint* retval = bi_alloc(n);
+  if (!retval)
+    return NULL;
+  bi_limb* r = retval->x;
+  memcpy(r, c->x, cn * sizeof(bi_limb));
+  memset(r + cn, 0, (n - cn) * sizeof(bi_limb));
+
+  retval->positive = c->positive;
+  if (c->positive == ppositive) {
+    bi_limb carry = bi_kern()->addmul(r, a->x, an, b->x, bn);
+    bi_limbs_add_1(r + an + bn, r + an + bn, n - an - bn, carry);
+  } else {
+    bi_limb borrow = bi_kern()->submul(r, a->x, an, b->x, bn);
+    if (bi_limbs_sub_1(r + an + bn, r + an + bn, n - an - bn, borrow)) {
+      // r = B^n + c - a b, so |c - a b| = B^n - r
+      borrow = 0;
+      for (size_t i = 0; i < n; i++)
+        borrow = bi_subb(&r[i], 0, r[i], borrow);
+      retval->positive = ppositive;
+    }
+  }
+  return bi_normalize(retval);
+}
+
+// Squaring
+//
+// The products a_i a_j for i != j come in equal pairs, so long squaring
+// forms each once, doubles the sum and adds the squares a_i^2; Karatsuba
+// squaring needs three half-size squarings and no second operand sum. The
+// decimal builds keep the vectorized multiplication kernel below the
+// Karatsuba threshold, since a row at a time it would split every product.
+#if defined(BI_BINARY)
+static void bi_sqr_basecase(bi_limb *r, const bi_limb *a, size_t n) {
+  r[0] = 0;
+  r[2 * n - 1] = 0;
+  if (n > 1) {
+    r[n] = bi_limbs_mul_1(r + 1, a + 1, n - 1, a[0]);
+    for (size_t i = 1; i + 1 < n; i++)
+      r[n + i] = bi_limbs_addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+    bi_limbs_add_n(r, r, r, 2 * n);
+  }
+
+  bi_limb carry = 0;
+  for (size_t i = 0; i < n; i++) {
+    bi_dlimb p = (bi_dlimb)a[i] * a[i];
+    bi_dlimb s = (bi_dlimb)r[2 * i] + (bi_limb)p + carry;
+    r[2 * i] = (bi_limb)s;
+    s = (bi_dlimb)r[2 * i + 1] + (bi_limb)(p >> 64) + (s >> 64);
+    r[2 * i + 1] = (bi_limb)s;
+    carry = (bi_limb)(s >> 64);
+  }
+}
+#else
+static void bi_sqr_basecase(bi_limb *r, const bi_limb *a, size_t n) {
+  bi_kern()->mul(r, a, n, a, n);
+}
+#endif
+
+// r = a^2 over 2n limbs, with bi_mul_tmp_size(n, n) scratch limbs
+static void bi_sqr_karatsuba(bi_limb *r, const bi_limb *a, size_t n,
+                             bi_limb *tmp) {
+  if (n < BI_KARATSUBA_THRESHOLD) {
+    bi_sqr_basecase(r, a, n);
+    return;
+  }
+
+  size_t h = (n + 1) / 2;
+  size_t a1n = n - h;
+  bi_sqr_karatsuba(r, a, h, tmp);
+  bi_sqr_karatsuba(r + 2 * h, a + h, a1n, tmp);
+
+  bi_limb* s = tmp;
+  bi_limb* z1 = tmp + h + 1;
+  s[h] = bi_limbs_add(s, a, h, a + h, a1n);
+  bi_sqr_karatsuba(z1, s, h + 1, tmp + 3 * (h + 1));
+  bi_limbs_sub(z1, z1, 2 * h + 2, r, 2 * h);
+  bi_limbs_sub(z1, z1, 2 * h + 2, r + 2 * h, 2 * a1n);
+
+  // 2 a0 a1 fits above B^h
+  size_t zn = bi_limbs_normalize(z1, 2 * h + 2);
+  bi_limbs_add(r + h, r + h, 2 * n - h, z1, zn);
+}
+
+// r = a^2, r not overlapping a; false if out of memory
+static bool bi_sqr_limbs(bi_limb *r, const bi_limb *a, size_t n) {
+  if (n < BI_KARATSUBA_THRESHOLD) {
+    bi_sqr_basecase(r, a, n);
+    return true;
+  }
+
+  bi_limb* tmp = malloc(bi_mul_tmp_size(n, n) * sizeof(bi_limb));
+  if (!tmp)
+    return false;
+  bi_sqr_karatsuba(r, a, n, tmp);
+  free(tmp);
+  return true;
+}
+
+// Powers
+//
+// |a|^n by left-to-right sliding windows: the bits of n are scanned from the
+// top, squaring once per bit, and every window of up to k bits ending in a
+// one multiplies by one of the precomputed odd powers |a|, |a|^3, ...
+// The result is bounded up front from the length and leading limb of a, so
+// two buffers of that size and a single Karatsuba scratch area serve all
+// steps. Powers of 10 in the decimal builds and of 2 in base 2^64 are only
+// a shift.
+
+// |a|^n for a nonzero a and n >= 1
+static bigint* bi_pow_abs(const bigint *a, uint64_t n) {
+  size_t an = a->xlen;
+  bi_limb top = a->x[an - 1];
+  bool shifted = bi_limbs_normalize(a->x, an - 1) == 0;
+#if defined(BI_BINARY)
+  if (shifted && !(top & (top - 1))) {
+    uint64_t k = (an - 1) * 64 + __builtin_ctzll(top);
+    if (k > UINT64_MAX / n)
+      return NULL;
+    return bi_pow2(k * n);
+  }
+#else
+  int d = bi_limb_digits(top) - 1;
+  bi_limb p = 1;
+  for (int i = 0; i < d; i++)
+    p *= 10;
+  if (shifted && top == p) {
+    // 10^(kn): zero limbs and a power of ten on top
+    uint64_t k = (an - 1) * BI_LIMB_DIGITS + d;
+    if (k > (uint64_t)INT_MAX * BI_LIMB_DIGITS / n)
+      return NULL;
+    uint64_t e = k * n;
+    size_t xlen = e / BI_LIMB_DIGITS + 1;
+    bigint* retval = bi_alloc(xlen);
+    if (!retval)
+      return NULL;
+    memset(retval->x, 0, (xlen - 1) * sizeof(bi_limb));
+    retval->x[xlen - 1] = 1;
+    for (int i = 0; i < (int)(e % BI_LIMB_DIGITS); i++)
+      retval->x[xlen - 1] *= 10;
+    retval->digits = -1;
+    return retval;
+  }
+#endif
+
+  // |a| < (top + 1) B^(an - 1); one more limb for a product's top limb and
+  // two for rounding in the estimate
+  double limbs = (double)n * ((double)(an - 1) +
+                              log((double)top + 1) / log((double)BI_RADIX));
+  if (limbs > INT_MAX - 3)
+    return NULL;
+  size_t size = (size_t)limbs + 3;
+
+  int bits = 64 - __builtin_clzll(n);
+  int k = bits > 40 ? 4 : bits > 16 ? 3 : bits > 6 ? 2 : 1;
+
+  // odd powers |a|^(2j + 1) for j < 2^(k - 1)
+  bigint* odd[8] = { NULL };
+  bigint* a2 = NULL;
+  bigint* retval = bi_alloc(size);
+  bi_limb* other = malloc(size * sizeof(bi_limb));
+  bi_limb* tmp = malloc(bi_mul_tmp_size(size, size) * sizeof(bi_limb));
+  bool ok = retval && other && tmp;
+  if (ok) {
+    bigint view = *a;
+    view.positive = true;
+    view.str = NULL;
+    odd[0] = bi_copy(&view);
+    if (k > 1)
+      a2 = bi_mul(&view, &view);
+    ok = odd[0] && (k == 1 || a2);
+    for (int j = 1; ok && j < 1 << (k - 1); j++)
+      ok = (odd[j] = bi_mul(odd[j - 1], a2)) != NULL;
+  }
+
+  bi_limb* cur = ok ? retval->x : NULL;
+  size_t len = 0;
+  for (int i = bits - 1; ok && i >= 0;) {
+    if (!(n >> i & 1)) {
+      bi_sqr_karatsuba(other, cur, len, tmp);
+      len = bi_limbs_normalize(other, 2 * len);
+      bi_limb* t = cur; cur = other; other = t;
+      i--;
+      continue;
+    }
+
+    // the longest window of at most k bits from bit i down ending in a one
+    int j = i - k + 1 < 0 ? 0 : i - k + 1;
+    while (!(n >> j & 1))
+      j++;
+    const bigint* w = odd[((n >> j) & ((2ULL << (i - j)) - 1)) / 2];
+    if (len == 0) {
+      memcpy(cur, w->x, w->xlen * sizeof(bi_limb));
+      len = w->xlen;
+    } else {
+      for (int s = i; s >= j; s--) {
+        bi_sqr_karatsuba(other, cur, len, tmp);
+        len = bi_limbs_normalize(other, 2 * len);
+        bi_limb* t = cur; cur = other; other = t;
+      }
+      if (len >= (size_t)w->xlen)
+        bi_mul_karatsuba(other, cur, len, w->x, w->xlen, tmp);
+      else
+        bi_mul_karatsuba(other, w->x, w->xlen, cur, len, tmp);
+      len = bi_limbs_normalize(other, len + w->xlen);
+      bi_limb* t = cur; cur = other; other = t;
+    }
+    i = j - 1;
+  }
+
+  for (int j = 0; j < 8; j++)
+    bi_delete(odd[j]);
+  bi_delete(a2);
+  free(tmp);
+  if (!ok) {
+    free(other);
+    bi_delete(retval);
+    return NULL;
+  }
+
+  // the result may have ended in the second buffer
+  if (cur != retval->x) {
+    memcpy(retval->x, cur, len * sizeof(bi_limb));
+    other = cur;
+  }
+  free(other);
+  retval->xlen = (int)len;
+  retval->digits = -1;
+  return retval;
+}
+
+// Division
+//
+// Short divisors and short quotients use schoolbook division. Otherwise the
+// divisor's reciprocal is found by Newton iteration and each quotient is
+// estimated from it (Barrett reduction), so a division costs a few
+// multiplications.
+#define BI_DIV_THRESHOLD 60
+
+// positive bigint from n limbs
+static bigint* bi_from_limbs(const bi_limb *x, size_t n) {
+  n = bi_limbs_normalize(x, n);
+  if (n == 0)
+    return bi_zero();
+
+  bigint* retval = bi_alloc(n);
+  if (!retval)
+    return NULL;
+  memcpy(retval->x, x, n * sizeof(bi_limb));
+  retval->digits = -1;
+  return retval;
+}
+
+// a B^k for k >= 0, a / B^-k rounded toward zero for k < 0
+static bigint* bi_shift_limbs(const bigint *a, long k) {
+  if (!a)
+    return NULL;
+  if (bi_is_zero(a) || (k < 0 && (size_t)-k >= (size_t)a->xlen))
+    return bi_zero();
+
+  size_t n = a->xlen + k;
+  bigint* retval = bi_alloc(n);
+  if (!retval)
+    return NULL;
+  if (k >= 0) {
+    memset(retval->x, 0, k * sizeof(bi_limb));
+    memcpy(retval->x + k, a->x, a->xlen * sizeof(bi_limb));
+  } else
+    memcpy(retval->x, a->x - k, n * sizeof(bi_limb));
+  retval->positive = a->positive;
+  retval->digits = -1;
+  return retval;
+}
+
+// Knuth, TAOCP vol. 2, 4.3.1, algorithm D on a scaled dividend: u holds
+// an + 1 limbs and v, dn >= 2 limbs, has a top limb of at least half the
+// base. q gets an - dn + 1 limbs and u is left with the scaled remainder.
+static void bi_limbs_divrem_scaled(bi_limb *q, bi_limb *u, size_t an,
+                                   const bi_limb *v, size_t dn) {
+  bi_limb vtop = v[dn - 1];
+  bi_limb vnext = v[dn - 2];
+  for (size_t j = an - dn + 1; j-- > 0;) {
+    bi_dlimb num = (bi_dlimb)u[j + dn] * BI_RADIX + u[j + dn - 1];
+    bi_dlimb qhat = num / vtop;
+    bi_dlimb rhat = num - qhat * vtop;
+    while (qhat >= BI_RADIX ||
+           qhat * vnext > rhat * BI_RADIX + u[j + dn - 2]) {
+      qhat--;
+      rhat += vtop;
+      if (rhat >= BI_RADIX)
+        break;
+    }
+
+    bi_limb borrow = bi_limbs_submul_1(u + j, v, dn, (bi_limb)qhat);
+    if (u[j + dn] < borrow) {
+      // one too large: add the divisor back
+      qhat--;
+      bi_limbs_add_n(u + j, u + j, v, dn);
+    }
+    u[j + dn] = 0;
+    q[j] = (bi_limb)qhat;
+  }
+}
+
+// the factor that scales a top limb t to at least half the base, which keeps
+// each estimated quotient limb at most two too large
+static inline bi_limb bi_div_scale(bi_limb t) {
+  return (bi_limb)(BI_RADIX / ((bi_dlimb)t + 1));
+}
+
+// q gets an - dn + 1 limbs and r gets dn limbs, for an >= dn and a
+// normalized d
+static bool bi_limbs_divrem_schoolbook(bi_limb *q, bi_limb *r,
+                                       const bi_limb *a, size_t an,
+                                       const bi_limb *d, size_t dn) {
+  if (dn == 1) {
+    r[0] = bi_limbs_divrem_1(q, a, an, d[0]);
+    return true;
+  }
+
+  bi_limb* u = malloc((an + 1 + dn) * sizeof(bi_limb));
+  if (!u)
+    return false;
+  bi_limb* v = u + an + 1;
+
+  bi_limb f = bi_div_scale(d[dn - 1]);
+  u[an] = bi_limbs_mul_1(u, a, an, f);
+  bi_limbs_mul_1(v, d, dn, f);
+  bi_limbs_divrem_scaled(q, u, an, v, dn);
+  bi_limbs_divrem_1(r, u, dn, f);
+  free(u);
+  return true;
+}
+
+static bool bi_divrem_schoolbook(bigint **q, bigint **r,
+                                 const bigint *a, const bigint *d) {
+  size_t an = a->xlen;
+  size_t dn = d->xlen;
+  bigint* quot = bi_alloc(an - dn + 1);
+  bigint* rem = bi_alloc(dn);
+  if (!quot || !rem ||
+      !bi_limbs_divrem_schoolbook(quot->x, rem->x, a->x, an, d->x, dn)) {
+    bi_delete(quot);
+    bi_delete(rem);
+    return false;
+  }
+
+  *q = bi_normalize(quot);
+  *r = bi_normalize(rem);
+  return true;
+}
+
+// floor(B^(2m) / d) for a positive d of m limbs
+static bigint* bi_reciprocal(const bigint *d) {
+  size_t m = d->xlen;
+  bigint* one = bi_from_limbs((const bi_limb[]){1}, 1);
+  bigint* p = bi_shift_limbs(one, 2 * m);
+  bi_delete(one);
+  if (!p)
+    return NULL;
+
+  bigint* x;
+  bigint* rem;
+  if (m < BI_DIV_THRESHOLD) {
+    if (!bi_divrem_schoolbook(&x, &rem, p, d))
+      x = NULL;
+    else
+      bi_delete(rem);
+    bi_delete(p);
+    return x;
+  }
+
+  // start from the reciprocal of the top half, good to about m / 2 limbs
+  size_t l = (m + 1) / 2;
+  bigint* dh = bi_shift_limbs(d, -(long)(m - l));
+  bigint* rh = dh ? bi_reciprocal(dh) : NULL;
+  x = bi_shift_limbs(rh, m - l);
+  bi_delete(dh);
+  bi_delete(rh);
+
+  // one Newton step, x += x (B^2m - d x) / B^2m, doubles the precision
+  bigint* dx = bi_mul(d, x);
+  bigint* e = bi_sub(p, dx);
+  bigint* xe = bi_mul(x, e);
+  bigint* c = bi_shift_limbs(xe, -(long)(2 * m));
+  bigint* x1 = bi_add(x, c);
+  bi_delete(x);
+  bi_delete(dx);
+  bi_delete(e);
+  bi_delete(xe);
+  bi_delete(c);
+
+  // x1 is off by a small multiple of B^2; the remainder gives the exact fix
+  dx = bi_mul(d, x1);
+  e = bi_sub(p, dx);
+  bi_delete(p);
+  bi_delete(dx);
+  if (!e) {
+    bi_delete(x1);
+    return NULL;
+  }
+
+  bigint* t = NULL;
+  rem = NULL;
+  if (bi_divrem_abs(&t, &rem, e, d, NULL) && !e->positive) {
+    // floor of a negative quotient
+    bigint* step = bi_from_limbs((const bi_limb[]){1}, 1);
+    bigint* up = bi_is_zero(rem) ? bi_copy(t) : bi_add(t, step);
+    bi_delete(t);
+    bi_delete(step);
+    t = bi_set_sign(up, false);
+  }
+  x = bi_add(x1, t);
+  bi_delete(x1);
+  bi_delete(t);
+  bi_delete(rem);
+  bi_delete(e);
+  return x;
+}
+
+// quotient and remainder of a < d B^m, d of m limbs, from inv = B^2m / d
+static bool bi_divrem_barrett_step(bigint **q, bigint **r, const bigint *a,
+                                   const bigint *d, const bigint *inv) {
+  long m = d->xlen;
+  bigint* top = bi_shift_limbs(a, -(m - 1));
+  bigint* prod = bi_mul(top, inv);
+  bigint* quot = bi_shift_limbs(prod, -(m + 1));
+  bigint* qd = bi_mul(quot, d);
+  bigint* rem = bi_sub(a, qd);
+  bi_delete(top);
+  bi_delete(prod);
+  bi_delete(qd);
+
+  // the estimate is low by at most two
+  bigint* one = bi_from_limbs((const bi_limb[]){1}, 1);
+  while (rem && quot && one && bi_cmp(rem, d) >= 0) {
+    bigint* next = bi_sub(rem, d);
+    bi_delete(rem);
+    rem = next;
+    next = bi_add(quot, one);
+    bi_delete(quot);
+    quot = next;
+  }
+  bi_delete(one);
+
+  if (!rem || !quot) {
+    bi_delete(rem);
+    bi_delete(quot);
+    return false;
+  }
+  *q = quot;
+  *r = rem;
+  return true;
+}
+
+// long division in blocks of m limbs, each a Barrett step
+static bool bi_divrem_barrett(bigint **q, bigint **r, const bigint *a,
+                              const bigint *d, const bigint *inv) {
+  size_t m = d->xlen;
+  size_t blocks = (a->xlen + m - 1) / m;
+  bigint* quot = bi_alloc(blocks * m);
+  bigint* cur = bi_from_limbs(a->x + (blocks - 1) * m,
+                              a->xlen - (blocks - 1) * m);
+  if (!quot || !cur) {
+    bi_delete(quot);
+    bi_delete(cur);
+    return false;
+  }
+
+  for (size_t i = blocks; i-- > 0;) {
+    bigint* qi;
+    bigint* ri;
+    bool ok = bi_divrem_barrett_step(&qi, &ri, cur, d, inv);
+    bi_delete(cur);
+    if (!ok) {
+      bi_delete(quot);
+      return false;
+    }
+
+    memset(quot->x + i * m, 0, m * sizeof(bi_limb));
+    if (qi->xlen > 0)
+      memcpy(quot->x + i * m, qi->x, qi->xlen * sizeof(bi_limb));
+    bi_delete(qi);
+    if (i == 0) {
+      *r = ri;
+      break;
+    }
+
+    // bring down the next block
+    cur = bi_alloc(m + ri->xlen);
+    if (!cur) {
+      bi_delete(ri);
+      bi_delete(quot);
+      return false;
+    }
+    memcpy(cur->x, a->x + (i - 1) * m, m * sizeof(bi_limb));
+    if (ri->xlen > 0)
+      memcpy(cur->x + m, ri->x, ri->xlen * sizeof(bi_limb));
+    bi_normalize(cur);
+    bi_delete(ri);
+  }
+
+  *q = bi_normalize(quot);
+  return true;
+}
+
+// whether dividing an limbs by dn limbs goes through the reciprocal
+static inline bool bi_div_uses_reciprocal(size_t an, size_t dn) {
+  return dn >= BI_DIV_THRESHOLD && an - dn >= BI_DIV_THRESHOLD;
+}
+
+// q = |a| / |d| and r = |a| % |d| for a non-zero d; inv is d's reciprocal
+// from bi_reciprocal, or NULL to compute it when it is needed
+static bool bi_divrem_abs(bigint **q, bigint **r, const bigint *a,
+                          const bigint *d, const bigint *inv) {
+  // positive views sharing the limbs
+  bigint av = *a;
+  bigint dv = *d;
+  av.positive = dv.positive = true;
+  av.str = dv.str = NULL;
+  a = &av;
+  d = &dv;
+
+  if (bi_limbs_cmp(a->x, a->xlen, d->x, d->xlen) < 0) {
+    *q = bi_zero();
+    *r = bi_set_sign(bi_copy(a), true);
+    if (*q && *r)
+      return true;
+    bi_delete(*q);
+    bi_delete(*r);
+    return false;
+  }
+
+  if (!bi_div_uses_reciprocal(a->xlen, d->xlen))
+    return bi_divrem_schoolbook(q, r, a, d);
+
+  bigint* own = NULL;
+  if (!inv) {
+    own = bi_reciprocal(d);
+    if (!own)
+      return false;
+    inv = own;
+  }
+  bool ok = bi_divrem_barrett(q, r, a, d, inv);
+  bi_delete(own);
+  return ok;
+}
+
+// Repeated division
+//
+// A bi_divisor does the per-divisor work of bi_divrem_abs once: the scaled
+// limbs used by schoolbook division and, for long divisors, the reciprocal
+// used by Barrett reduction.
+struct bi_divisor {
+  bigint* d;     // |d|
+  bool positive;
+  bi_limb f;     // scale factor of the schoolbook path
+  bi_limb* v;    // d f, dn limbs, when d has at least two limbs
+  bigint* inv;   // floor(B^2dn / |d|), for dn >= BI_DIV_THRESHOLD
+};
+
+bi_divisor* bi_divisor_new(const bigint *d) {
+  if (!d || bi_is_zero(d))
+    return NULL;
+
+  bi_divisor* retval = calloc(1, sizeof(bi_divisor));
+  if (!retval)
+    return NULL;
+  retval->positive = d->positive;
+  retval->d = bi_set_sign(bi_copy(d), true);
+  if (!retval->d) {
+    bi_divisor_delete(retval);
+    return NULL;
+  }
+
+  size_t dn = d->xlen;
+  if (dn >= 2) {
+    retval->f = bi_div_scale(d->x[dn - 1]);
+    retval->v = malloc(dn * sizeof(bi_limb));
+    if (!retval->v) {
+      bi_divisor_delete(retval);
+      return NULL;
+    }
+    bi_limbs_mul_1(retval->v, d->x, dn, retval->f);
+  }
+  if (dn >= BI_DIV_THRESHOLD && !(retval->inv = bi_reciprocal(retval->d))) {
+    bi_divisor_delete(retval);
+    return NULL;
+  }
+  return retval;
+}
+
+void bi_divisor_delete(bi_divisor *d) {
+  if (d) {
+    bi_delete(d->d);
+    free(d->v);
+    bi_delete(d->inv);
+    free(d);
+  }
+}
+
+// q = |a| / |d| and r = |a| % |d| with the precomputed data
+static bool bi_divrem_by_abs(bigint **q, bigint **r, const bigint *a,
+                             const bi_divisor *div) {
+  size_t an = a->xlen;
+  size_t dn = div->d->xlen;
+  if (bi_limbs_cmp(a->x, an, div->d->x, dn) < 0 ||
+      bi_div_uses_reciprocal(an, dn))
+    return bi_divrem_abs(q, r, a, div->d, div->inv);
+
+  bigint* quot = bi_alloc(an - dn + 1);
+  bigint* rem = bi_alloc(dn);
+  bi_limb* u = dn >= 2 ? malloc((an + 1) * sizeof(bi_limb)) : NULL;
+  if (!quot || !rem || (dn >= 2 && !u)) {
+    bi_delete(quot);
+    bi_delete(rem);
+    free(u);
+    return false;
+  }
+
+  if (dn == 1)
+    rem->x[0] = bi_limbs_divrem_1(quot->x, a->x, an, div->d->x[0]);
+  else {
+    u[an] = bi_limbs_mul_1(u, a->x, an, div->f);
+    bi_limbs_divrem_scaled(quot->x, u, an, div->v, dn);
+    bi_limbs_divrem_1(rem->x, u, dn, div->f);
+    free(u);
+  }
+
+  *q = bi_normalize(quot);
+  *r = bi_normalize(rem);
+  return true;
+}
+
+bigint* bi_divmod_by(const bi_divisor *d, const bigint *a, bigint **r) {
+  if (!d || !a)
+    return NULL;
+
+  bigint* q;
+  bigint* rem;
+  if (!bi_divrem_by_abs(&q, &rem, a, d))
+    return NULL;
+
+  // truncated like bi_div: the remainder takes the sign of a
+  if (r)
+    *r = bi_set_sign(rem, bi_is_zero(rem) || a->positive);
+  else
+    bi_delete(rem);
+  return bi_set_sign(q, bi_is_zero(q) || a->positive == d->positive);
+}
+
+// Accumulation
+//
+// A bi_acc sums its terms limb by limb into double-limb lanes, the positive
+// and the negative terms apart, without carrying: each term costs one pass
+// of the add_wide kernel over its limbs. The lanes are carried only when
+// BI_ACC_ADDS more terms could overflow them, and when the value is read.
+#ifndef BI_ACC_ADDS
+#if BI_LIMB_BITS == 64
+#define BI_ACC_ADDS ((uint64_t)1 << 63)
+#else
+#define BI_ACC_ADDS ((uint64_t)1 << 34)
+#endif
+#endif
+
+struct bi_acc {
+  bi_dlimb* lanes[2]; // sums of the positive and of the negative terms
+  size_t n;           // lanes in use in both
+  size_t cap;
+  uint64_t adds;      // terms since the lanes were last carried
+};
+
+bi_acc* bi_acc_new(void) {
+  return calloc(1, sizeof(bi_acc));
+}
+
+void bi_acc_delete(bi_acc *acc) {
+  if (acc) {
+    free(acc->lanes[0]);
+    free(acc->lanes[1]);
+    free(acc);
+  }
+}
+
+// the low limb of a lane plus carry, returning the rest as the next carry
+static inline bi_dlimb bi_acc_split(bi_dlimb v, bi_limb *lo) {
+#if defined(BI_BINARY)
+  *lo = (bi_limb)v;
+  return v >> 64;
+#else
+  return bi_split_wide(v, lo);
+#endif
+}
+
+// room for n lanes and the carries that can run past them
+static bool bi_acc_reserve(bi_acc *acc, size_t n) {
+  n += 3;
+  if (n <= acc->cap)
+    return true;
+  size_t cap = acc->cap * 2 > n ? acc->cap * 2 : n;
+  for (int s = 0; s < 2; s++) {
+    bi_dlimb* lanes = realloc(acc->lanes[s], cap * sizeof(bi_dlimb));
+    if (!lanes)
+      return false;
+    memset(lanes + acc->cap, 0, (cap - acc->cap) * sizeof(bi_dlimb));
+    acc->lanes[s] = lanes;
+  }
+  acc->cap = cap;
+  return true;
+}
+
+// brings every lane below B, the carries moving up
+static void bi_acc_carry(bi_acc *acc) {
+  for (int s = 0; s < 2; s++) {
+    bi_dlimb* lanes = acc->lanes[s];
+    bi_dlimb carry = 0;
+    for (size_t i = 0; i < acc->cap; i++) {
+      bi_limb lo;
+      carry = bi_acc_split(lanes[i] + carry, &lo);
+      lanes[i] = lo;
+    }
+  }
+  for (size_t i = acc->n; i < acc->cap; i++)
+    if (acc->lanes[0][i] || acc->lanes[1][i])
+      acc->n = i + 1;
+  acc->adds = 0;
+}
+
+static bool bi_acc_addsub(bi_acc *acc, const bigint *a, bool sub) {
+  if (!acc || !a)
+    return false;
+  if (bi_is_zero(a))
+    return true;
+
+  size_t n = a->xlen;
+  if (!bi_acc_reserve(acc, n > acc->n ? n : acc->n))
+    return false;
+  if (acc->adds == BI_ACC_ADDS) {
+    bi_acc_carry(acc);
+    if (!bi_acc_reserve(acc, n > acc->n ? n : acc->n))
+      return false;
+  }
+  if (n > acc->n)
+    acc->n = n;
+
+  bi_kern()->add_wide(acc->lanes[a->positive == sub], a->x, n);
+  acc->adds++;
+  return true;
+}
+
+bool bi_acc_add(bi_acc *acc, const bigint *a) {
+  return bi_acc_addsub(acc, a, false);
+}
+
+bool bi_acc_sub(bi_acc *acc, const bigint *a) {
+  return bi_acc_addsub(acc, a, true);
+}
+
+// the carried lanes of one sign as a magnitude
+static bigint* bi_acc_lanes(const bi_acc *acc, int s) {
+  size_t n = acc->n + 3;
+  bigint* retval = bi_alloc(n);
+  if (!retval)
+    return NULL;
+  bi_dlimb carry = 0;
+  for (size_t i = 0; i < n; i++)
+    carry = bi_acc_split((i < acc->n ? acc->lanes[s][i] : 0) + carry,
+                         &retval->x[i]);
+  return bi_normalize(retval);
+}
+
+bigint* bi_acc_value(const bi_acc *acc) {
+  if (!acc)
+    return NULL;
+  if (acc->n == 0)
+    return bi_zero();
+
+  bigint* plus = bi_acc_lanes(acc, 0);
+  bigint* minus = bi_acc_lanes(acc, 1);
+  bigint* retval = plus && minus ? bi_sub(plus, minus) : NULL;
+  bi_delete(plus);
+  bi_delete(minus);
+  return retval;
+}
+
+// Batches
+//
+// bi_add_n, bi_sub_n and bi_mul_n size all n results first and take their
+// structs and limbs from one block, then run the kernels pair after pair
+// with none of the per-call checks, allocations or sign juggling of the
+// single operations. The results are released together by bi_delete_n.
+enum { BI_BATCH_ADD, BI_BATCH_SUB, BI_BATCH_MUL };
+
+// limbs reserved for a op b
+static size_t bi_batch_limbs(const bigint *a, const bigint *b, int op) {
+  size_t an = a->xlen;
+  size_t bn = b->xlen;
+  if (op == BI_BATCH_MUL)
+    return an && bn ? an + bn : 0;
+  return (an > bn ? an : bn) + 1;
+}
+
+// r = a + (+/-)|b| into r->x, bpositive the sign b is taken to have
+static void bi_batch_addsub(bigint *r, const bigint *a, const bigint *b,
+                            bool bpositive) {
+  size_t an = a->xlen;
+  size_t bn = b->xlen;
+  if (an == 0 || bn == 0 || a->positive == bpositive) {
+    r->positive = an ? a->positive : bpositive;
+    if (an < bn) {
+      const bigint* tmp = a;
+      a = b;
+      b = tmp;
+      an = a->xlen;
+      bn = b->xlen;
+    }
+    if (an == 0) {
+      r->xlen = 0;
+      return;
+    }
+    r->x[an] = bi_limbs_add(r->x, a->x, an, b->x, bn);
+    r->xlen = (int)an + 1;
+    return;
+  }
+
+  int cmp = bi_limbs_cmp(a->x, an, b->x, bn);
+  if (cmp >= 0) {
+    bi_limbs_sub(r->x, a->x, an, b->x, bn);
+    r->positive = a->positive;
+    r->xlen = (int)an;
+  } else {
+    bi_limbs_sub(r->x, b->x, bn, a->x, an);
+    r->positive = bpositive;
+    r->xlen = (int)bn;
+  }
+}
+
+// r = a b into r->x; false if out of memory
+static bool bi_batch_mul(bigint *r, const bigint *a, const bigint *b) {
+  r->positive = a->positive == b->positive;
+  if (a->xlen < b->xlen) {
+    const bigint* tmp = a;
+    a = b;
+    b = tmp;
+  }
+  size_t an = a->xlen;
+  size_t bn = b->xlen;
+  r->xlen = bn ? (int)(an + bn) : 0;
+  if (bn == 0)
+    return true;
+  if (bn < BI_KARATSUBA_THRESHOLD && bn > 1) {
+    bi_kern()->mul(r->x, a->x, an, b->x, bn);
+    return true;
+  }
+  return bi_mul_limbs(r->x, a->x, an, b->x, bn);
+}
+
+static bool bi_batch_run(bigint **r, bigint *const *a, bigint *const *b,
+                         size_t n, int op) {
+  if (!(r && a && b))
+    return false;
+  if (n == 0)
+    return true;
+
+  size_t limbs = 0;
+  for (size_t i = 0; i < n; i++) {
+    // One operand is NULL
+    if (!(a[i] && b[i]))
+      return false;
+    limbs += bi_batch_limbs(a[i], b[i], op);
+  }
+
+  bigint* out = malloc(n * sizeof(bigint) + limbs * sizeof(bi_limb));
+  if (!out)
+    return false;
+  bi_limb* x = (bi_limb *)(out + n);
+  for (size_t i = 0; i < n; i++) {
+    bigint* c = &out[i];
+    c->x = x;
+    c->str = NULL;
+    x += bi_batch_limbs(a[i], b[i], op);
+    if (op == BI_BATCH_MUL) {
+      if (!bi_batch_mul(c, a[i], b[i])) {
+        free(out);
+        return false;
+      }
+    } else {
+      bi_batch_addsub(c, a[i], b[i],
+                      op == BI_BATCH_ADD ? b[i]->positive : !b[i]->positive);
+    }
+
+    // bi_normalize, but the limbs stay in the block
+    c->xlen = (int)bi_limbs_normalize(c->x, c->xlen);
+    c->digits = -1;
+    if (c->xlen == 0) {
+      c->x = NULL;
+      c->digits = 0;
+      c->positive = true;
+    }
+  }
+  for (size_t i = 0; i < n; i++)
+    r[i] = &out[i];
+  return true;
+}
+
+bool bi_add_n(bigint **r, bigint *const *a, bigint *const *b, size_t n) {
+  return bi_batch_run(r, a, b, n, BI_BATCH_ADD);
+}
+
+bool bi_sub_n(bigint **r, bigint *const *a, bigint *const *b, size_t n) {
+  return bi_batch_run(r, a, b, n, BI_BATCH_SUB);
+}
+
+bool bi_mul_n(bigint **r, bigint *const *a, bigint *const *b, size_t n) {
+  return bi_batch_run(r, a, b, n, BI_BATCH_MUL);
+}
+
+void bi_delete_n(bigint **r, size_t n) {
+  if (!r || n == 0)
+    return;
+  for (size_t i = 0; i < n; i++)
+    free(r[i]->str);
+  free(r[0]);
+}
+
+// Vectors
+//
+// A bi_vec keeps n numbers of the same width in structure-of-arrays form:
+// limb i of number k sits at x[i * lanes + k], so the same limb of many
+// numbers is contiguous. The element-wise operations run every lane through
+// the same instructions, BI_VEC_BLOCK lanes at a time in fixed-length inner
+// loops that the compiler turns into SIMD code. Signs do not branch: a
+// lane that subtracts adds the complement of b plus one and, if that comes
+// out negative, complements the result back, under per-lane masks.
+// Products sum columns of double limbs as the long multiplication kernel
+// does in the decimal builds, and run rows with their carries in binary.
+#define BI_VEC_BLOCK 8
+#define BI_VEC_ROWS 16  // products a decimal column sum takes between carries
+
+struct bi_vec {
+  size_t n;
+  size_t lanes;   // n rounded up to BI_VEC_BLOCK; the padding holds zeros
+  size_t width;   // limbs per number
+  bool* positive;
+  bi_limb* x;     // limb i of number k at x[i * lanes + k]
+};
+
+static bi_vec* bi_vec_alloc(size_t n, size_t width) {
+  bi_vec* retval = malloc(sizeof(bi_vec));
+  if (!retval)
+    return NULL;
+  retval->n = n;
+  retval->lanes = (n + BI_VEC_BLOCK - 1) / BI_VEC_BLOCK * BI_VEC_BLOCK;
+  retval->width = width;
+  size_t limbs = width * retval->lanes;
+  retval->positive = calloc(retval->lanes ? retval->lanes : 1, sizeof(bool));
+  retval->x = calloc(limbs ? limbs : 1, sizeof(bi_limb));
+  if (!retval->positive || !retval->x) {
+    bi_vec_delete(retval);
+    return NULL;
+  }
+  return retval;
+}
+
+bi_vec* bi_vec_new(bigint *const *a, size_t n) {
+  if (!a)
+    return NULL;
+  size_t width = 1;
+  for (size_t k = 0; k < n; k++) {
+    if (!a[k])
+      return NULL;
+    if ((size_t)a[k]->xlen > width)
+      width = a[k]->xlen;
+  }
+
+  bi_vec* retval = bi_vec_alloc(n, width);
+  if (!retval)
+    return NULL;
+  for (size_t k = 0; k < retval->lanes; k++)
+    retval->positive[k] = k >= n || a[k]->positive;
+  for (size_t k = 0; k < n; k++)
+    for (size_t i = 0; i < (size_t)a[k]->xlen; i++)
+      retval->x[i * retval->lanes + k] = a[k]->x[i];
+  return retval;
+}
+
+void bi_vec_delete(bi_vec *v) {
+  if (v) {
+    free(v->positive);
+    free(v->x);
+    free(v);
+  }
+}
+
+size_t bi_vec_size(const bi_vec *v) {
+  return v ? v->n : 0;
+}
+
+bigint* bi_vec_get(const bi_vec *v, size_t k) {
+  if (!v || k >= v->n)
+    return NULL;
+  bigint* retval = bi_alloc(v->width);
+  if (!retval)
+    return NULL;
+  for (size_t i = 0; i < v->width; i++)
+    retval->x[i] = v->x[i * v->lanes + k];
+  retval->positive = v->positive[k];
+  return bi_normalize(retval);
+}
+
+// a + b, or a - b with sub, over one block of lanes into r of width w
+static void bi_vec_addsub_block(bi_limb *r, size_t rl, const bi_limb *a,
+                                size_t al, size_t an, const bi_limb *b,
+                                size_t bl, size_t bn, size_t w, bool *rpos,
+                                const bool *apos, const bool *bpos, bool sub) {
+  bi_limb mask[BI_VEC_BLOCK];  // all ones in the lanes that subtract
+  bi_limb carry[BI_VEC_BLOCK];
+  for (size_t k = 0; k < BI_VEC_BLOCK; k++) {
+    mask[k] = -(bi_limb)(apos[k] != (bpos[k] != sub));
+    carry[k] = mask[k] & 1;
+  }
+
+  // |a| + |b|, or |a| + (B^w - 1 - |b|) + 1
+  for (size_t i = 0; i < w; i++) {
+    for (size_t k = 0; k < BI_VEC_BLOCK; k++) {
+      bi_limb av = i < an ? a[i * al + k] : 0;
+      bi_limb bv = i < bn ? b[i * bl + k] : 0;
+      bv ^= mask[k] & (bv ^ (BI_LIMB_MAX - bv));
+      carry[k] = bi_addc(&r[i * rl + k], av, bv, carry[k]);
+    }
+  }
+
+  // without a carry out, |a| < |b| and the result is B^w - r with b's sign
+  for (size_t k = 0; k < BI_VEC_BLOCK; k++) {
+    mask[k] &= carry[k] - 1;
+    carry[k] = mask[k] & 1;
+    rpos[k] = apos[k] != (mask[k] & 1);
+  }
+  for (size_t i = 0; i < w; i++) {
+    for (size_t k = 0; k < BI_VEC_BLOCK; k++) {
+      bi_limb t = r[i * rl + k];
+      t ^= mask[k] & (t ^ (BI_LIMB_MAX - t));
+      carry[k] = bi_addc(&r[i * rl + k], t, 0, carry[k]);
+    }
+  }
+}
+
+static bi_vec* bi_vec_addsub(const bi_vec *a, const bi_vec *b, bool sub) {
+  if (!(a && b) || a->n != b->n)
+    return NULL;
+  size_t w = (a->width > b->width ? a->width : b->width) + 1;
+  bi_vec* retval = bi_vec_alloc(a->n, w);
+  if (!retval)
+    return NULL;
+  for (size_t k = 0; k < a->lanes; k += BI_VEC_BLOCK)
+    bi_vec_addsub_block(retval->x + k, retval->lanes, a->x + k, a->lanes,
+                        a->width, b->x + k, b->lanes, b->width, w,
+                        retval->positive + k, a->positive + k,
+                        b->positive + k, sub);
+  return retval;
+}
+
+bi_vec* bi_vec_add(const bi_vec *a, const bi_vec *b) {
+  return bi_vec_addsub(a, b, false);
+}
+
+bi_vec* bi_vec_sub(const bi_vec *a, const bi_vec *b) {
+  return bi_vec_addsub(a, b, true);
+}
+
+#if defined(BI_BINARY)
+// |a| |b| over one block of lanes into r, zeroed, row by row
+static void bi_vec_mul_block(bi_limb *r, size_t rl, const bi_limb *a,
+                             size_t al, size_t an, const bi_limb *b,
+                             size_t bl, size_t bn, bi_dlimb *acc) {
+  (void)acc;
+  for (size_t j = 0; j < bn; j++) {
+    bi_limb carry[BI_VEC_BLOCK] = { 0 };
+    for (size_t i = 0; i < an; i++) {
+      for (size_t k = 0; k < BI_VEC_BLOCK; k++) {
+        bi_limb* rk = &r[(i + j) * rl + k];
+        carry[k] = bi_split((bi_dlimb)a[i * al + k] * b[j * bl + k] + *rk +
+                            carry[k], rk);
+      }
+    }
+    for (size_t k = 0; k < BI_VEC_BLOCK; k++)
+      r[(j + an) * rl + k] = carry[k];
+  }
+}
+#else
+// |a| |b| over one block of lanes into r through the column sums acc, which
+// are carried after every BI_VEC_ROWS rows
+static void bi_vec_mul_block(bi_limb *r, size_t rl, const bi_limb *a,
+                             size_t al, size_t an, const bi_limb *b,
+                             size_t bl, size_t bn, bi_dlimb *acc) {
+  size_t w = an + bn;
+  memset(acc, 0, w * BI_VEC_BLOCK * sizeof(bi_dlimb));
+  for (size_t j0 = 0; j0 < bn; j0 += BI_VEC_ROWS) {
+    size_t j1 = bn - j0 < BI_VEC_ROWS ? bn : j0 + BI_VEC_ROWS;
+    for (size_t j = j0; j < j1; j++) {
+      for (size_t i = 0; i < an; i++) {
+        bi_dlimb* col = &acc[(i + j) * BI_VEC_BLOCK];
+        for (size_t k = 0; k < BI_VEC_BLOCK; k++)
+          col[k] += (bi_dlimb)a[i * al + k] * b[j * bl + k];
+      }
+    }
+
+    // back below B, the carries moving up
+    bi_dlimb carry[BI_VEC_BLOCK] = { 0 };
+    for (size_t c = 0; c < w; c++) {
+      for (size_t k = 0; k < BI_VEC_BLOCK; k++) {
+        bi_limb lo;
+        carry[k] = bi_split_wide(acc[c * BI_VEC_BLOCK + k] + carry[k], &lo);
+        acc[c * BI_VEC_BLOCK + k] = lo;
+      }
+    }
+  }
+  for (size_t c = 0; c < w; c++)
+    for (size_t k = 0; k < BI_VEC_BLOCK; k++)
+      r[c * rl + k] = (bi_limb)acc[c * BI_VEC_BLOCK + k];
+}
+#endif
+
+bi_vec* bi_vec_mul(const bi_vec *a, const bi_vec *b) {
+  if (!(a && b) || a->n != b->n)
+    return NULL;
+  size_t w = a->width + b->width;
+  bi_vec* retval = bi_vec_alloc(a->n, w);
+  bi_dlimb* acc = malloc(w * BI_VEC_BLOCK * sizeof(bi_dlimb));
+  if (!retval || !acc) {
+    bi_vec_delete(retval);
+    free(acc);
+    return NULL;
+  }
+  for (size_t k = 0; k < a->lanes; k += BI_VEC_BLOCK) {
+    bi_vec_mul_block(retval->x + k, retval->lanes, a->x + k, a->lanes,
+                     a->width, b->x + k, b->lanes, b->width, acc);
+    for (size_t l = k; l < k + BI_VEC_BLOCK; l++)
+      retval->positive[l] = a->positive[l] == b->positive[l];
+  }
+  free(acc);
+  return retval;
+}
+
+// Thread pool
+//
+// Parallel work is cut into tasks run by a process-wide pool of threads.
+// Every thread that forks tasks or runs them has its own deque (Chase and
+// Lev, "Dynamic circular work-stealing deque", with the memory orders of Le
+// et al., "Correct and efficient work-stealing for weak memory models"):
+// its owner pushes and pops at the bottom without contention, and idle
+// threads steal the oldest task from the top with one compare-and-swap. A
+// thread waiting on its tasks runs them, or steals others, until they are
+// done, so tasks may fork further tasks. No lock is taken on that path; the
+// pool mutex only parks threads that found nothing to do.
+#define BI_DEQUE_SIZE 4096  // a task forked onto a full deque runs at once
+#define BI_POOL_SLOTS 256   // deques of workers and of forking threads
+
+struct bi_join {
+  long pending;
+};
+
+struct bi_task {
+  void (*run)(struct bi_task *);
+  struct bi_join* join;
+};
+
+struct bi_deque {
+  long top;
+  long bottom;
+  int free;  // its thread has exited; the deque is empty and can be reused
+  struct bi_task* buf[BI_DEQUE_SIZE];
+};
+
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  struct bi_deque* slots[BI_POOL_SLOTS];
+  int nslots;
+  int workers;  // threads started
+  int threads;  // the setting, 0 until first read
+  long epoch;   // bumped after tasks are pushed
+  int sleeping;
+  pthread_once_t once;
+  pthread_key_t key;
+} bi_pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+              { NULL }, 0, 0, 0, 0, 0, PTHREAD_ONCE_INIT, 0 };
+
+static __thread struct bi_deque* bi_self;
+static __thread uint32_t bi_victim;
+
+static bool bi_deque_push(struct bi_deque *d, struct bi_task *t) {
+  long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+  long top = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+  if (b - top >= BI_DEQUE_SIZE)
+    return false;
+  __atomic_store_n(&d->buf[b % BI_DEQUE_SIZE], t, __ATOMIC_RELAXED);
+  __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+static struct bi_task* bi_deque_pop(struct bi_deque *d) {
+  long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+  __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  long top = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+  struct bi_task* t = NULL;
+  if (top <= b) {
+    t = __atomic_load_n(&d->buf[b % BI_DEQUE_SIZE], __ATOMIC_RELAXED);
+    if (top == b) {
+      // the last task: a thief may be taking it too
+      if (!__atomic_compare_exchange_n(&d->top, &top, top + 1, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        t = NULL;
+      __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+  } else {
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+  }
+  return t;
+}
+
+static struct bi_task* bi_deque_steal(struct bi_deque *d) {
+  long top = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  long b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+  if (top >= b)
+    return NULL;
+  struct bi_task* t = __atomic_load_n(&d->buf[top % BI_DEQUE_SIZE],
+                                      __ATOMIC_RELAXED);
+  if (!__atomic_compare_exchange_n(&d->top, &top, top + 1, false,
+                                   __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    return NULL;
+  return t;
+}
+
+static void bi_deque_release(void *d) {
+  __atomic_store_n(&((struct bi_deque *)d)->free, 1, __ATOMIC_RELEASE);
+}
+
+static void bi_pool_init(void) {
+  pthread_key_create(&bi_pool.key, bi_deque_release);
+}
+
+// this thread's deque, NULL when all slots are taken
+static struct bi_deque* bi_pool_deque(void) {
+  if (bi_self)
+    return bi_self;
+  pthread_once(&bi_pool.once, bi_pool_init);
+
+  pthread_mutex_lock(&bi_pool.lock);
+  struct bi_deque* d = NULL;
+  for (int i = 0; i < bi_pool.nslots && !d; i++)
+    if (__atomic_load_n(&bi_pool.slots[i]->free, __ATOMIC_ACQUIRE))
+      d = bi_pool.slots[i];
+  if (d) {
+    __atomic_store_n(&d->free, 0, __ATOMIC_RELAXED);
+  } else if (bi_pool.nslots < BI_POOL_SLOTS &&
+             (d = calloc(1, sizeof(struct bi_deque)))) {
+    bi_pool.slots[bi_pool.nslots] = d;
+    __atomic_store_n(&bi_pool.nslots, bi_pool.nslots + 1, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&bi_pool.lock);
+
+  if (d) {
+    pthread_setspecific(bi_pool.key, d);
+    bi_victim = (uint32_t)(uintptr_t)d;
+  }
+  return bi_self = d;
+}
+
+// a task of another thread, starting from a different victim each time
+static struct bi_task* bi_pool_steal(void) {
+  int n = __atomic_load_n(&bi_pool.nslots, __ATOMIC_ACQUIRE);
+  bi_victim = bi_victim * 1103515245u + 12345u;
+  for (int i = 0; i < n; i++) {
+    struct bi_deque* d = bi_pool.slots[(bi_victim >> 8) % (uint32_t)n];
+    struct bi_task* t = d != bi_self ? bi_deque_steal(d) : NULL;
+    if (t)
+      return t;
+    bi_victim++;
+  }
+  return NULL;
+}
+
+static void bi_task_run(struct bi_task *t) {
+  struct bi_join* join = t->join;
+  t->run(t);
+  __atomic_fetch_sub(&join->pending, 1, __ATOMIC_RELEASE);
+}
+
+static void* bi_pool_worker(void *arg) {
+  int index = (int)(intptr_t)arg;
+  if (!bi_pool_deque())
+    return NULL;
+
+  for (;;) {
+    long epoch = __atomic_load_n(&bi_pool.epoch, __ATOMIC_SEQ_CST);
+    if (index < bi_threads() - 1) {
+      struct bi_task* t = bi_deque_pop(bi_self);
+      if (!t)
+        t = bi_pool_steal();
+      if (t) {
+        bi_task_run(t);
+        continue;
+      }
+    }
+
+    // nothing to do: park until more tasks are pushed
+    pthread_mutex_lock(&bi_pool.lock);
+    __atomic_fetch_add(&bi_pool.sleeping, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&bi_pool.epoch, __ATOMIC_SEQ_CST) == epoch)
+      pthread_cond_wait(&bi_pool.wake, &bi_pool.lock);
+    __atomic_fetch_sub(&bi_pool.sleeping, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&bi_pool.lock);
+  }
+  return NULL;
+}
+
+static void bi_pool_notify(void) {
+  __atomic_fetch_add(&bi_pool.epoch, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&bi_pool.sleeping, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&bi_pool.lock);
+    pthread_cond_broadcast(&bi_pool.wake);
+    pthread_mutex_unlock(&bi_pool.lock);
+  }
+}
+
+// starts workers up to the setting, the forking thread being one more
+static void bi_pool_start(int threads) {
+  if (__atomic_load_n(&bi_pool.workers, __ATOMIC_ACQUIRE) >= threads - 1)
+    return;
+  pthread_mutex_lock(&bi_pool.lock);
+  while (bi_pool.workers < threads - 1 &&
+         bi_pool.workers < BI_POOL_SLOTS - 1) {
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    bool ok = pthread_create(&thread, &attr, bi_pool_worker,
+                             (void *)(intptr_t)bi_pool.workers) == 0;
+    pthread_attr_destroy(&attr);
+    if (!ok)
+      break;
+    __atomic_store_n(&bi_pool.workers, bi_pool.workers + 1, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&bi_pool.lock);
+}
+
+// runs t under join, on another thread if one is free to take it
+static void bi_pool_fork(struct bi_task *t, struct bi_join *join) {
+  t->join = join;
+  __atomic_fetch_add(&join->pending, 1, __ATOMIC_RELAXED);
+  int threads = bi_threads();
+  struct bi_deque* d = threads > 1 ? bi_pool_deque() : NULL;
+  if (!d || !bi_deque_push(d, t)) {
+    bi_task_run(t);
+    return;
+  }
+  bi_pool_start(threads);
+  bi_pool_notify();
+}
+
+// waits for the tasks forked under join, running tasks meanwhile
+static void bi_pool_join(struct bi_join *join) {
+  while (__atomic_load_n(&join->pending, __ATOMIC_ACQUIRE) > 0) {
+    struct bi_task* t = bi_self ? bi_deque_pop(bi_self) : NULL;
+    if (!t)
+      t = bi_pool_steal();
+    if (t)
+      bi_task_run(t);
+    else
+      sched_yield();
+  }
+}
+
+int bi_threads(void) {
+  int threads = __atomic_load_n(&bi_pool.threads, __ATOMIC_RELAXED);
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus < 1 ? 1 : cpus > BI_POOL_SLOTS / 2 ? BI_POOL_SLOTS / 2 :
+              (int)cpus;
+    __atomic_store_n(&bi_pool.threads, threads, __ATOMIC_RELAXED);
+  }
+  return threads;
+}
+
+void bi_threads_set(int threads) {
+  if (threads < 1)
+    threads = 1;
+  if (threads > BI_POOL_SLOTS / 2)
+    threads = BI_POOL_SLOTS / 2;
+  __atomic_store_n(&bi_pool.threads, threads, __ATOMIC_RELAXED);
+  bi_pool_notify();
+}
+
+// Batch executor
+//
+// A bi_batch collects operations and runs them on the pool when waited on.
+// The range of operations is split in halves of equal estimated cost,
+// limb products for multiplications and the like and limbs for additions,
+// down to BI_BATCH_GRAIN; each half is a task, so long multiplications and
+// runs of short additions spread over the threads by stealing.
+#define BI_BATCH_GRAIN ((uint64_t)1 << 15)
+
+struct bi_batch_op {
+  bigint* (*op)(const bigint *, const bigint *);
+  const bigint* a;
+  const bigint* b;
+  bigint** r;
+};
+
+struct bi_batch_range {
+  struct bi_task task;
+  bi_batch* batch;
+  size_t lo;
+  size_t hi;
+};
+
+struct bi_batch {
+  struct bi_batch_op* ops;
+  size_t n;
+  size_t cap;
+  uint64_t* cost;                // cost[i]: the cost of ops before i
+  struct bi_batch_range* ranges;
+  size_t nranges;
+  bool failed;
+};
+
+bi_batch* bi_batch_new(void) {
+  return calloc(1, sizeof(bi_batch));
+}
+
+void bi_batch_delete(bi_batch *batch) {
+  if (batch) {
+    free(batch->ops);
+    free(batch);
+  }
+}
+
+bool bi_batch_submit(bi_batch *batch,
+                     bigint *(*op)(const bigint *, const bigint *),
+                     const bigint *a, const bigint *b, bigint **r) {
+  if (!(batch && op && r))
+    return false;
+  if (batch->n == batch->cap) {
+    size_t cap = batch->cap ? 2 * batch->cap : 64;
+    struct bi_batch_op* ops = realloc(batch->ops, cap * sizeof(*ops));
+    if (!ops)
+      return false;
+    batch->ops = ops;
+    batch->cap = cap;
+  }
+  struct bi_batch_op* o = &batch->ops[batch->n++];
+  o->op = op;
+  o->a = a;
+  o->b = b;
+  o->r = r;
+  return true;
+}
+
+static uint64_t bi_batch_cost(const struct bi_batch_op *o) {
+  uint64_t an = o->a ? (uint64_t)o->a->xlen + 1 : 1;
+  uint64_t bn = o->b ? (uint64_t)o->b->xlen + 1 : 1;
+  return o->op == bi_add || o->op == bi_sub ? an + bn : an * bn;
+}
+
+static void bi_batch_range_run(bi_batch *batch, size_t lo, size_t hi,
+                               struct bi_join *join);
+
+static void bi_batch_task(struct bi_task *t) {
+  struct bi_batch_range* range = (struct bi_batch_range *)t;
+  bi_batch_range_run(range->batch, range->lo, range->hi, t->join);
+}
+
+static void bi_batch_range_run(bi_batch *batch, size_t lo, size_t hi,
+                               struct bi_join *join) {
+  // fork the upper half while it is worth a task of its own
+  while (batch->cost && hi - lo > 1 &&
+         batch->cost[hi] - batch->cost[lo] > BI_BATCH_GRAIN) {
+    uint64_t half = batch->cost[lo] + (batch->cost[hi] - batch->cost[lo]) / 2;
+    size_t l = lo + 1;
+    size_t h = hi - 1;
+    while (l < h) {
+      size_t m = l + (h - l) / 2;
+      if (batch->cost[m] < half)
+        l = m + 1;
+      else
+        h = m;
+    }
+    struct bi_batch_range* range =
+      &batch->ranges[__atomic_fetch_add(&batch->nranges, 1, __ATOMIC_RELAXED)];
+    range->task.run = bi_batch_task;
+    range->batch = batch;
+    range->lo = l;
+    range->hi = hi;
+    bi_pool_fork(&range->task, join);
+    hi = l;
+  }
+
+  for (size_t i = lo; i < hi; i++) {
+    struct bi_batch_op* o = &batch->ops[i];
+    *o->r = o->op(o->a, o->b);
+    if (!*o->r)
+      __atomic_store_n(&batch->failed, true, __ATOMIC_RELAXED);
+  }
+}
+
+bool bi_batch_wait(bi_batch *batch) {
+  if (!batch)
+    return false;
+  size_t n = batch->n;
+  if (n == 0)
+    return true;
+
+  // without room for the split points, the operations run in order here
+  batch->cost = malloc((n + 1) * sizeof(uint64_t));
+  batch->ranges = malloc(n * sizeof(struct bi_batch_range));
+  if (!batch->cost || !batch->ranges) {
+    free(batch->cost);
+    batch->cost = NULL;
+  } else {
+    batch->cost[0] = 0;
+    for (size_t i = 0; i < n; i++)
+      batch->cost[i + 1] = batch->cost[i] + bi_batch_cost(&batch->ops[i]);
+  }
+  batch->nranges = 0;
+  batch->failed = false;
+
+  struct bi_join join = { 0 };
+  bi_batch_range_run(batch, 0, n, &join);
+  bi_pool_join(&join);
+
+  free(batch->cost);
+  free(batch->ranges);
+  batch->cost = NULL;
+  batch->ranges = NULL;
+  batch->n = 0;
+  return !__atomic_load_n(&batch->failed, __ATOMIC_RELAXED);
+}
+
+// Parallel multiplication
+//
+// From BI_PARALLEL_THRESHOLD limbs up, the top levels of the Karatsuba
+// recursion run on the thread pool: z0, z2 and the middle product are
+// independent, so two are forked while the third is formed, each with
+// scratch of its own. When b is at most half as long as a, the two halves of
+// a are multiplied by b at once. Levels are split until there are
+// BI_PARALLEL_TASKS products per thread; below that the serial code runs.
+#define BI_PARALLEL_THRESHOLD 1024
+#define BI_PARALLEL_TASKS 4
+
+struct bi_mul_task {
+  struct bi_task task;
+  bi_limb* r;
+  const bi_limb* a;
+  size_t an;
+  const bi_limb* b;
+  size_t bn;
+  size_t width;  // products formed side by side at this level
+  bool ok;
+};
+
+static void bi_mul_task(struct bi_task *t) {
+  struct bi_mul_task* m = (struct bi_mul_task *)t;
+  m->ok = bi_mul_parallel(m->r, m->a, m->an, m->b, m->bn, m->width);
+}
+
+// r = a b, a square when a and b are the same limbs; false if out of memory
+static bool bi_mul_parallel(bi_limb *r, const bi_limb *a, size_t an,
+                            const bi_limb *b, size_t bn, size_t width) {
+  if (an < bn) {
+    const bi_limb* t = a;
+    a = b;
+    b = t;
+    size_t tn = an;
+    an = bn;
+    bn = tn;
+  }
+  bool sqr = a == b && an == bn;
+  size_t threads = (size_t)bi_threads();
+  if (bn < BI_PARALLEL_THRESHOLD || threads < 2 ||
+      width >= threads * BI_PARALLEL_TASKS)
+    return sqr ? bi_sqr_limbs(r, a, an) : bi_mul_limbs(r, a, an, b, bn);
+
+  struct bi_join join = { 0 };
+  size_t h = (an + 1) / 2;
+  if (bn <= h) {
+    // a0 b in r, a1 b on the side, then added in above B^h
+    bi_limb* hi = malloc((an - h + bn) * sizeof(bi_limb));
+    if (!hi)
+      return false;
+    struct bi_mul_task a1b = { { bi_mul_task, NULL }, hi, a + h, an - h, b, bn,
+                               2 * width, false };
+    bi_pool_fork(&a1b.task, &join);
+    bool ok = bi_mul_parallel(r, a, h, b, bn, 2 * width);
+    bi_pool_join(&join);
+    if (ok && a1b.ok) {
+      memset(r + h + bn, 0, (an - h) * sizeof(bi_limb));
+      bi_limbs_add(r + h, r + h, an + bn - h, hi, an - h + bn);
+    }
+    free(hi);
+    return ok && a1b.ok;
+  }
+
+  size_t a1n = an - h;
+  size_t b1n = bn - h;
+  bi_limb* tmp = malloc(4 * (h + 1) * sizeof(bi_limb));
+  if (!tmp)
+    return false;
+  bi_limb* sa = tmp;
+  bi_limb* sb = sqr ? sa : tmp + h + 1;
+  bi_limb* z1 = tmp + 2 * (h + 1);
+  sa[h] = bi_limbs_add(sa, a, h, a + h, a1n);
+  if (!sqr)
+    sb[h] = bi_limbs_add(sb, b, h, b + h, b1n);
+
+  struct bi_mul_task z2 = { { bi_mul_task, NULL }, r + 2 * h, a + h, a1n,
+                            b + h, b1n, 3 * width, false };
+  struct bi_mul_task mid = { { bi_mul_task, NULL }, z1, sa, h + 1, sb, h + 1,
+                             3 * width, false };
+  bi_pool_fork(&z2.task, &join);
+  bi_pool_fork(&mid.task, &join);
+  bool ok = bi_mul_parallel(r, a, h, b, h, 3 * width);
+  bi_pool_join(&join);
+
+  ok = ok && z2.ok && mid.ok;
+  if (ok) {
+    bi_limbs_sub(z1, z1, 2 * h + 2, r, 2 * h);
+    bi_limbs_sub(z1, z1, 2 * h + 2, r + 2 * h, a1n + b1n);
+    size_t zn = bi_limbs_normalize(z1, 2 * h + 2);
+    bi_limbs_add(r + h, r + h, an + bn - h, z1, zn);
+  }
+  free(tmp);
+  return ok;
+}
+
+// Exact division
+//
+// When d divides a, the quotient is also a d^-1 mod B^n for n quotient
+// limbs, which can be found from the low end without estimating anything
+// (Jebelean): each quotient limb is the current low limb times d[0]^-1 mod
+// B, and no remainder is formed. Long quotients instead lift d^-1 mod B^n by
+// Newton's iteration and take one product. Both need d[0] prime to the base,
+// so common factors 2 (and 5 in the decimal builds) are divided out of a and
+// d first.
+
+// the factor of a number made of the base's primes that its low limb t
+// shows; a limb of 10^k only tells 2^k and 5^k apart from the rest
+static bi_limb bi_base_part(bi_limb t) {
+  bi_limb g = 1;
+#if defined(BI_BINARY)
+  g <<= __builtin_ctzll(t);
+#else
+  for (int i = 0; i < BI_LIMB_DIGITS && t % 2 == 0; i++, t /= 2)
+    g *= 2;
+  for (int i = 0; i < BI_LIMB_DIGITS && t % 5 == 0; i++, t /= 5)
+    g *= 5;
+#endif
+  return g;
+}
+
+// a b mod B
+static inline bi_limb bi_mullo(bi_limb a, bi_limb b) {
+#if defined(BI_BINARY)
+  return a * b;
+#else
+  return (bi_limb)((bi_dlimb)a * b % BASE);
+#endif
+}
+
+// t^-1 mod B for t prime to the base; x' = x (2 - t x) doubles the digits
+// (bits in base 2^64) of t^-1 that are right
+static bi_limb bi_limb_inverse(bi_limb t) {
+#if defined(BI_BINARY)
+  bi_limb x = t;  // right to 3 bits for odd t
+  for (int i = 0; i < 5; i++)
+    x *= 2 - t * x;
+#else
+  static const bi_limb inv10[10] = { 0, 1, 0, 7, 0, 0, 0, 3, 0, 9 };
+  bi_limb x = inv10[t % 10];
+  for (int i = 0; i < 5; i++)
+    x = bi_mullo(x, (2 + BASE - bi_mullo(t, x)) % BASE);
+#endif
+  return x;
+}
+
+// d^-1 mod B^n for d[0] prime to the base, d of dn limbs
+static bigint* bi_inverse_mod_limbs(const bi_limb *d, size_t dn, size_t n) {
+  if (n == 1) {
+    bi_limb x = bi_limb_inverse(d[0]);
+    return bi_from_limbs(&x, 1);
+  }
+
+  // x is right mod B^k; d x = 1 + B^k h, and x (1 - B^k h) is right mod B^2k
+  size_t k = (n + 1) / 2;
+  bigint* x = bi_inverse_mod_limbs(d, dn, k);
+  bigint* dl = bi_from_limbs(d, dn < n ? dn : n);
+  bigint* t = x && dl ? bi_mul(dl, x) : NULL;
+  bigint* h = t && (size_t)t->xlen > k
+      ? bi_from_limbs(t->x + k, (t->xlen < (int)n ? t->xlen : n) - k)
+      : bi_zero();
+  bigint* c = t && h ? bi_mul(x, h) : NULL;
+  bigint* retval = c ? bi_alloc(n) : NULL;
+  if (retval) {
+    // low k limbs from x, high n - k limbs -c mod B^(n - k)
+    memset(retval->x, 0, n * sizeof(bi_limb));
+    memcpy(retval->x, x->x, x->xlen * sizeof(bi_limb));
+    size_t cn = (size_t)c->xlen < n - k ? c->xlen : n - k;
+    bi_limbs_sub(retval->x + k, retval->x + k, n - k, c->x, cn);
+    retval->digits = -1;
+    bi_normalize(retval);
+  }
+  bi_delete(x);
+  bi_delete(dl);
+  bi_delete(t);
+  bi_delete(h);
+  bi_delete(c);
+  return retval;
+}
+
+// q = u / v mod B^qn, low to high, destroying the low qn limbs of u
+static void bi_limbs_bdiv(bi_limb *q, bi_limb *u, size_t qn,
+                          const bi_limb *v, size_t vn) {
+  bi_limb vinv = bi_limb_inverse(v[0]);
+  for (size_t i = 0; i < qn; i++) {
+    q[i] = bi_mullo(u[i], vinv);
+    size_t n = vn < qn - i ? vn : qn - i;
+    bi_limb borrow = bi_limbs_submul_1(u + i, v, n, q[i]);
+    if (i + n < qn)
+      bi_limbs_sub_1(u + i + n, u + i + n, qn - i - n, borrow);
+  }
+}
+
+bigint* bi_divexact(const bigint *a, const bigint *d) {
+  // One operand is NULL, or division by zero
+  if (!(a && d) || bi_is_zero(d))
+    return NULL;
+  if (a->xlen < d->xlen)
+    return bi_zero();
+
+  // zero low limbs of d are zero in a too
+  size_t z = 0;
+  while (d->x[z] == 0)
+    z++;
+  size_t an = a->xlen - z;
+  size_t dn = d->xlen - z;
+  bi_limb* u = malloc((an + dn) * sizeof(bi_limb));
+  if (!u)
+    return NULL;
+  bi_limb* v = u + an;
+  memcpy(u, a->x + z, an * sizeof(bi_limb));
+  memcpy(v, d->x + z, dn * sizeof(bi_limb));
+
+  for (bi_limb g; (g = bi_base_part(v[0])) != 1;) {
+    bi_limbs_divrem_1(u, u, an, g);
+    bi_limbs_divrem_1(v, v, dn, g);
+    an = bi_limbs_normalize(u, an);
+    dn = bi_limbs_normalize(v, dn);
+  }
+
+  bigint* retval;
+  size_t qn = an - dn + 1;
+  if (an < dn)
+    retval = bi_zero();
+  else if (qn < BI_DIV_THRESHOLD) {
+    retval = bi_alloc(qn);
+    if (retval) {
+      bi_limbs_bdiv(retval->x, u, qn, v, dn);
+      retval->digits = -1;
+      bi_normalize(retval);
+    }
+  } else {
+    // only the low qn limbs of a and d matter
+    bigint* inv = bi_inverse_mod_limbs(v, dn, qn);
+    bigint* al = bi_from_limbs(u, qn);
+    bigint* p = inv && al ? bi_mul(al, inv) : NULL;
+    retval = p ? bi_from_limbs(p->x, (size_t)p->xlen < qn ? p->xlen : qn)
+               : NULL;
+    bi_delete(inv);
+    bi_delete(al);
+    bi_delete(p);
+  }
+  free(u);
+
+  if (!retval)
+    return NULL;
+  return bi_set_sign(retval, bi_is_zero(retval) ||
+                             a->positive == d->positive);
+}
+
+// Roots
+//
+// Square roots follow Zimmermann's recursion ("Karatsuba Square Root",
+// 1999), a Newton step that doubles the precision at each level: for
+// a = a' b^2 + a1 b + a0 with b = B^l and a' >= b^2, the root s' of a' and
+// its remainder r' give s = s' b + floor((r' b + a1) / (2 s')), which is at
+// most one too large. k-th roots take the root of the leading limbs, good
+// to about half the limbs of the result, as the start of Newton's iteration
+// x = ((k - 1) x + a / x^(k-1)) / k from above, where x^k <= a stops it
+// without another step. Roots of up to four limbs start from a
+// double-precision estimate.
+
+// log2(a) for a > 0, from its leading limbs; three of them fill the double
+// even below a small top limb
+static double bi_log2(const bigint *a) {
+  size_t n = a->xlen;
+  size_t m = n < 3 ? n : 3;
+  double top = 0;
+  for (size_t i = n; i-- > n - m;)
+    top = top * (double)BI_RADIX + a->x[i];
+  return log2(top) + (double)(n - m) * log2((double)BI_RADIX);
+}
+
+// floor(a^(1/k)) for a > 0 as a magnitude by Newton's iteration from x,
+// which must not be below the root; NULL x starts from a double estimate.
+// The iterates fall until they reach the root. Takes x.
+static bigint* bi_root_newton(const bigint *a, uint64_t k, bigint *x) {
+  if (!x) {
+    // 2^(log2(a) / k), raised past the rounding errors
+    double l = bi_log2(a) / k;
+    double e = floor(l);
+    bigint* est = bi_from_double(ldexp(exp2(l - e) * (1 + 0x1p-30), (int)e));
+    x = bi_add_si(est, 1);
+    bi_delete(est);
+  }
+
+  bigint abs = *a;
+  abs.positive = true;
+  abs.str = NULL;
+  // p = x^(k-1) serves both the step and the test after it
+  bigint* p = x ? bi_pow(x, k - 1) : NULL;
+  while (p) {
+    // y = ((k - 1) x + a / x^(k-1)) / k
+    bigint* t = bi_div(&abs, p);
+    bigint* kx = t ? bi_mul_si(x, (int64_t)(k - 1)) : NULL;
+    bigint* sum = kx ? bi_add(kx, t) : NULL;
+    bigint* y = sum ? bi_divmod_si(sum, (int64_t)k, NULL) : NULL;
+    bi_delete(t);
+    bi_delete(kx);
+    bi_delete(sum);
+    if (!y) {
+      bi_delete(p);
+      bi_delete(x);
+      return NULL;
+    }
+    if (bi_cmp(y, x) >= 0) {
+      bi_delete(y);
+      break;
+    }
+
+    bi_delete(x);
+    bi_delete(p);
+    x = y;
+    p = bi_pow(x, k - 1);
+
+    // y^k <= a shows that y is the root for less than another step
+    bigint* xk = p ? bi_mul(p, x) : NULL;
+    bool done = xk && bi_cmp(xk, &abs) <= 0;
+    bi_delete(xk);
+    if (done)
+      break;
+  }
+  // the loop only ends without p when out of memory
+  if (!p) {
+    bi_delete(x);
+    return NULL;
+  }
+  bi_delete(p);
+  return x;
+}
+
+// s = floor(sqrt(a)) and r = a - s^2 for a > 0 as a magnitude
+static bool bi_sqrtrem_abs(bigint **s, bigint **r, const bigint *a) {
+  size_t n = a->xlen;
+  bigint ap = *a;
+  ap.positive = true;
+  ap.str = NULL;
+  if (n <= 4) {
+    *s = bi_root_newton(&ap, 2, NULL);
+    bigint* sq = *s ? bi_mul(*s, *s) : NULL;
+    *r = sq ? bi_sub(&ap, sq) : NULL;
+    bi_delete(sq);
+    if (!*r) {
+      bi_delete(*s);
+      return false;
+    }
+    return true;
+  }
+
+  // a' has n - 2l >= 2l + 1 limbs, so a' >= b^2
+  size_t l = (n - 1) / 4;
+  size_t n1 = bi_limbs_normalize(a->x + l, l);
+  size_t n0 = bi_limbs_normalize(a->x, l);
+  bigint a1 = { true, -1, (int)n1, n1 ? a->x + l : NULL, NULL };
+  bigint a0 = { true, -1, (int)n0, n0 ? a->x : NULL, NULL };
+  bigint* top = bi_shift_limbs(&ap, -(long)(2 * l));
+  bigint *s1, *r1;
+  if (!top || !bi_sqrtrem_abs(&s1, &r1, top)) {
+    bi_delete(top);
+    return false;
+  }
+  bi_delete(top);
+
+  // q, u = divmod(r' b + a1, 2 s'); s = s' b + q, r = u b + a0 - q^2
+  bigint* rb = bi_shift_limbs(r1, l);
+  bigint* num = rb ? bi_add(rb, &a1) : NULL;
+  bigint* twice = bi_add(s1, s1);
+  bigint *q = NULL, *u = NULL;
+  bool ok = num && twice && bi_divrem_abs(&q, &u, num, twice, NULL);
+  bi_delete(rb);
+  bi_delete(num);
+  bi_delete(twice);
+  bi_delete(r1);
+  bigint* sb = ok ? bi_shift_limbs(s1, l) : NULL;
+  bigint* ub = ok ? bi_shift_limbs(u, l) : NULL;
+  bigint* qq = ok ? bi_mul(q, q) : NULL;
+  bigint* ua = ub ? bi_add(ub, &a0) : NULL;
+  *s = sb ? bi_add(sb, q) : NULL;
+  *r = ua && qq ? bi_sub(ua, qq) : NULL;
+  bi_delete(s1);
+  bi_delete(q);
+  bi_delete(u);
+  bi_delete(sb);
+  bi_delete(ub);
+  bi_delete(qq);
+  bi_delete(ua);
+
+  // one too large: r + 2s - 1 = a - (s - 1)^2
+  if (*s && *r && !(*r)->positive && !bi_is_zero(*r)) {
+    bigint* t = bi_add(*r, *s);
+    bigint* t2 = t ? bi_add(t, *s) : NULL;
+    bigint* r2 = t2 ? bi_sub_si(t2, 1) : NULL;
+    bigint* s2 = bi_sub_si(*s, 1);
+    bi_delete(t);
+    bi_delete(t2);
+    bi_delete(*r);
+    bi_delete(*s);
+    *r = r2;
+    *s = s2;
+  }
+  if (!*s || !*r) {
+    bi_delete(*s);
+    bi_delete(*r);
+    return false;
+  }
+  return true;
+}
+
+// floor(a^(1/k)) for a > 0 as a magnitude and 2 < k < log2(a) + 1
+static bigint* bi_root_abs(const bigint *a, uint64_t k) {
+  // the root has at most ceil(n / k) limbs; the root of a / B^jk gives
+  // all but j of them, enough for one step of Newton's iteration to reach
+  // the root or its successor
+  size_t n = a->xlen;
+  size_t rn = (n + k - 1) / k;
+  if (rn <= 4)
+    return bi_root_newton(a, k, NULL);
+
+  size_t j = (rn - 3) / 2;
+  bigint* top = bi_shift_limbs(a, -(long)(j * k));
+  bigint* rt = top ? bi_root_abs(top, k) : NULL;
+  // ((rt + 1) B^j)^k >= (top + 1) B^jk > a
+  bigint* up = rt ? bi_add_si(rt, 1) : NULL;
+  bigint* x = up ? bi_shift_limbs(up, j) : NULL;
+  bi_delete(top);
+  bi_delete(rt);
+  bi_delete(up);
+  return x ? bi_root_newton(a, k, x) : NULL;
+}
+
+bigint* bi_sqrtrem(const bigint *a, bigint **r) {
+  if (!a || (!a->positive && !bi_is_zero(a)))
+    return NULL;
+
+  bigint* s;
+  bigint* rem;
+  if (bi_is_zero(a)) {
+    s = bi_zero();
+    rem = bi_zero();
+    if (!s || !rem) {
+      bi_delete(s);
+      bi_delete(rem);
+      return NULL;
+    }
+  } else if (!bi_sqrtrem_abs(&s, &rem, a))
+    return NULL;
+
+  if (r)
+    *r = rem;
+  else
+    bi_delete(rem);
+  return s;
+}
+
+bigint* bi_sqrt(const bigint *a) {
+  return bi_sqrtrem(a, NULL);
+}
+
+bigint* bi_root(const bigint *a, uint64_t k) {
+  if (!a || k == 0 || (!a->positive && !bi_is_zero(a) && k % 2 == 0))
+    return NULL;
+  if (k == 1 || bi_is_zero(a) || (a->xlen == 1 && a->x[0] == 1))
+    return bi_copy(a);
+  if (k == 2)
+    return bi_sqrt(a);
+
+  // 1 <= |a| < 2^k has the root 1
+  bigint* retval;
+  if (bi_log2(a) < (double)k - 1) {
+    bigint view;
+    bi_limb x[BI_WORD_LIMBS];
+    retval = bi_copy(bi_word(&view, x, true, 1));
+  } else
+    retval = bi_root_abs(a, k);
+  return bi_set_sign(retval, a->positive);
+}
+
+// Perfect squares and powers
+//
+// Most candidates are rejected by residues before any root is taken. One
+// pass sums the limbs at even and at odd positions: as B = 1 modulo B - 1
+// and B = -1 modulo B + 1, their sum and difference give a modulo the
+// primes p dividing B - 1 and B + 1. A k-th power is a k-th power residue
+// modulo p, t = 0 or t^((p-1)/k) = 1, which restricts it for p = 1 mod k.
+// Squares are also checked modulo 64, which divides B, from the low limb.
+// Exponents k with long roots are sieved modulo primes p = 1 mod k first.
+#if defined(BI_BINARY)
+static const uint32_t bi_residue_primes[] = {
+  3, 5, 17, 257, 641, 65537, 6700417, 274177 };
+#define BI_RESIDUE_MINUS 7  // the first ones divide B - 1, the rest B + 1
+#elif defined(BI_LIMB_DEC18)
+static const uint32_t bi_residue_primes[] = {
+  3, 7, 11, 13, 19, 37, 52579, 333667, 101, 9901 };
+#define BI_RESIDUE_MINUS 8
+#else
+static const uint32_t bi_residue_primes[] = {
+  3, 37, 333667, 7, 11, 13, 19, 52579 };
+#define BI_RESIDUE_MINUS 3
+#endif
+#define BI_RESIDUE_PRIMES \
+  (sizeof(bi_residue_primes) / sizeof(bi_residue_primes[0]))
+
+// the squares modulo 64 as bits
+#define BI_SQUARES_MOD_64 0x0202021202030213ULL
+
+// |a| modulo each residue prime
+static void bi_residues(const bigint *a, uint32_t *r) {
+  bi_dlimb even = 0, odd = 0;
+  size_t n = a->xlen;
+  size_t i = 0;
+  for (; i + 1 < n; i += 2) {
+    even += a->x[i];
+    odd += a->x[i + 1];
+  }
+  if (i < n)
+    even += a->x[i];
+  for (size_t j = 0; j < BI_RESIDUE_PRIMES; j++) {
+    uint32_t p = bi_residue_primes[j];
+    uint64_t e = (uint64_t)(even % p), o = (uint64_t)(odd % p);
+    r[j] = (uint32_t)(j < BI_RESIDUE_MINUS ? (e + o) % p : (e + p - o) % p);
+  }
+}
+
+// whether t mod p is 0 or a k-th power residue, for a prime p < 2^32
+static bool bi_power_residue(uint64_t t, uint64_t k, uint64_t p) {
+  if (t == 0 || (p - 1) % k != 0)
+    return true;
+  uint64_t r = 1;
+  for (uint64_t e = (p - 1) / k; e; e >>= 1) {
+    if (e & 1)
+      r = r * t % p;
+    t = t * t % p;
+  }
+  return r == 1;
+}
+
+// whether the residues allow |a| to be a k-th power
+static bool bi_power_residues(const uint32_t *r, uint64_t k) {
+  for (size_t j = 0; j < BI_RESIDUE_PRIMES; j++)
+    if (!bi_power_residue(r[j], k, bi_residue_primes[j]))
+      return false;
+  return true;
+}
+
+// whether x^k has the residues r of |a|
+static bool bi_residues_match(const uint32_t *r, uint64_t x, uint64_t k) {
+  for (size_t j = 0; j < BI_RESIDUE_PRIMES; j++) {
+    uint64_t p = bi_residue_primes[j];
+    uint64_t t = x % p, xk = 1;
+    for (uint64_t e = k; e; e >>= 1) {
+      if (e & 1)
+        xk = xk * t % p;
+      t = t * t % p;
+    }
+    if (xk != r[j])
+      return false;
+  }
+  return true;
+}
+
+// the number of factors 2 in a != 0, or -1 when the low limb cannot tell
+static int bi_twos(const bigint *a) {
+#if defined(BI_BINARY)
+  size_t i = 0;
+  while (a->x[i] == 0)
+    i++;
+  return (int)(i * 64) + __builtin_ctzll(a->x[i]);
+#else
+  // 2^BI_LIMB_DIGITS divides B
+  uint64_t low = a->x[0] % ((uint64_t)1 << BI_LIMB_DIGITS);
+  return low ? __builtin_ctzll(low) : -1;
+#endif
+}
+
+// |a| modulo a word p < 2^32
+static uint64_t bi_mod_word(const bigint *a, uint64_t p) {
+  uint64_t radix = (uint64_t)(BI_RADIX % p), r = 0;
+  for (size_t i = a->xlen; i-- > 0;)
+    r = (r * radix + (uint64_t)(a->x[i] % p)) % p;
+  return r;
+}
+
+// whether |a| passes as a k-th power modulo the first few primes
+// p = 2 m k + 1, each of which lets through about 1 in k non-powers
+static bool bi_power_sieve(const bigint *a, uint64_t k) {
+  int found = 0;
+  for (uint64_t p = 2 * k + 1; found < 3 && p < ((uint64_t)1 << 32);
+       p += 2 * k) {
+    bool prime = true;
+    for (uint64_t d = 3; d * d <= p && prime; d += 2)
+      prime = p % d != 0;
+    if (!prime)
+      continue;
+    if (!bi_power_residue(bi_mod_word(a, p), k, p))
+      return false;
+    found++;
+  }
+  return true;
+}
+
+// whether |a| = x^k, by taking the root
+static bool bi_is_power_of(const bigint *a, uint64_t k) {
+  bigint abs = *a;
+  abs.positive = true;
+  abs.str = NULL;
+  bool retval = false;
+  if (k == 2) {
+    bigint* r;
+    bigint* s = bi_sqrtrem(&abs, &r);
+    retval = s && bi_is_zero(r);
+    bi_delete(s);
+    bi_delete(r);
+  } else {
+    bigint* x = bi_root(&abs, k);
+    bigint* p = x ? bi_pow(x, k) : NULL;
+    retval = p && bi_cmp(p, &abs) == 0;
+    bi_delete(x);
+    bi_delete(p);
+  }
+  return retval;
+}
+
+bool bi_is_square(const bigint *a) {
+  if (!a || (!a->positive && !bi_is_zero(a)))
+    return false;
+  if (bi_is_zero(a))
+    return true;
+  if (!(BI_SQUARES_MOD_64 >> (a->x[0] % 64) & 1))
+    return false;
+
+  uint32_t r[BI_RESIDUE_PRIMES];
+  bi_residues(a, r);
+  return bi_power_residues(r, 2) && bi_is_power_of(a, 2);
+}
+
+bool bi_is_perfect_power(const bigint *a) {
+  if (!a)
+    return false;
+  if (bi_is_zero(a) || (a->xlen == 1 && a->x[0] == 1))
+    return true;
+  if (a->positive && bi_is_square(a))
+    return true;
+
+  // odd exponents k, which are all a negative a can have; with a root of
+  // two or more, k <= log2 |a|
+  uint32_t r[BI_RESIDUE_PRIMES];
+  bi_residues(a, r);
+  int twos = bi_twos(a);
+  double l = bi_log2(a);
+  for (uint64_t k = 3; (double)k <= l + 1; k += 2) {
+    if ((twos > 0 && (uint64_t)twos % k != 0) || !bi_power_residues(r, k))
+      continue;
+
+    // composite k have an odd prime factor tried before
+    bool prime = true;
+    for (uint64_t d = 3; d * d <= k && prime; d += 2)
+      prime = k % d != 0;
+    if (!prime)
+      continue;
+
+    if (l / k < 32) {
+      // a root below 2^32 is the nearest whole number to the double
+      // estimate, and then k log2(x) matches log2 |a| to within the
+      // rounding errors of both, far below 2^-40 of it. Its parity is that
+      // of a where the low limb tells, and x^k must match the residues of a
+      // before it is worth forming.
+      double rx = nearbyint(exp2(l / k));
+      if (rx < 2 || fabs((double)k * log2(rx) - l) > l * 0x1p-40 ||
+          (twos == 0 && fmod(rx, 2) == 0) || (twos > 0 && fmod(rx, 2) != 0) ||
+          !bi_residues_match(r, (uint64_t)rx, k))
+        continue;
+      bigint view;
+      bi_limb xv[BI_WORD_LIMBS];
+      bigint* p = bi_pow(bi_word(&view, xv, true, (uint64_t)rx), k);
+      bool equal = p && bi_limbs_cmp(p->x, p->xlen, a->x, a->xlen) == 0;
+      bi_delete(p);
+      if (equal)
+        return true;
+      continue;
+    }
+
+    if (bi_power_sieve(a, k) && bi_is_power_of(a, k))
+      return true;
+  }
+  return false;
+}
+
+// Greatest common divisors
+//
+// Lehmer's algorithm: the leading BI_GCD_WORD bits (digits in the decimal
+// builds) of x >= y, taken at the same scale, run Euclid's algorithm in
+// machine words for as long as the quotients provably match those of the
+// full numbers (Knuth, TAOCP vol. 2, 4.5.2, algorithm L). The steps are
+// then applied to x and y at once as a 2x2 matrix of words, so most of the
+// work is a few linear passes per word of quotients. When the words cannot
+// decide a step, one full division is done instead.
+//
+// The cofactors u of x (u x = the current x mod y) alternate in sign along
+// Euclid's remainder sequence, so only their magnitudes are kept and every
+// update is a sum. x, y and the cofactors live in buffers allocated once.
+//
+// Long operands first go through half-gcds (Schoenhage; Moeller, "On
+// Schoenhage's algorithm and subquadratic integer gcd computation"): the
+// steps that halve x and y are found recursively from their top halves, as
+// a 2x2 matrix of cofactors applied with bi_mul, in O(M(n) log n). Steps
+// from the top limbs may overshoot at the end; those are taken back until
+// the remainders are in order again.
+#if defined(BI_BINARY)
+#define BI_GCD_WORD 62
+#else
+#define BI_GCD_WORD 18
+#endif
+
+// Below BI_HGCD_THRESHOLD limbs Lehmer's algorithm beats the half-gcd.
+#if defined(BI_BINARY)
+#define BI_HGCD_THRESHOLD 100
+#else
+#define BI_HGCD_THRESHOLD 150
+#endif
+
+// length of a normalized x in bits, or digits in the decimal builds
+static size_t bi_gcd_length(const bi_limb *x, size_t n) {
+  if (n == 0)
+    return 0;
+#if defined(BI_BINARY)
+  return 64 * n - __builtin_clzll(x[n - 1]);
+#else
+  return (n - 1) * BI_LIMB_DIGITS + bi_limb_digits(x[n - 1]);
+#endif
+}
+
+// floor(x / 2^s), or floor(x / 10^s) in the decimal builds, for results
+// below 2^BI_GCD_WORD
+static uint64_t bi_gcd_top(const bi_limb *x, size_t n, size_t s) {
+#if defined(BI_BINARY)
+  size_t i = s / 64;
+  int b = s % 64;
+  if (i >= n)
+    return 0;
+  uint64_t w = x[i] >> b;
+  if (b && i + 1 < n)
+    w |= x[i + 1] << (64 - b);
+  return w;
+#else
+  size_t i = s / BI_LIMB_DIGITS;
+  int r = s % BI_LIMB_DIGITS;
+  if (i >= n)
+    return 0;
+  uint64_t p = 1;
+  for (int k = 0; k < r; k++)
+    p *= 10;
+  uint64_t w = x[i] / p;
+  uint64_t scale = BASE / p;
+  for (size_t j = i + 1; j < n; j++) {
+    w += x[j] * scale;
+    if (j + 1 < n)
+      scale *= BASE;
+  }
+  return w;
+#endif
+}
+
+// r = a w, returning the normalized length
+static size_t bi_limbs_mul_word(bi_limb *r, const bi_limb *a, size_t an,
+                                uint64_t w) {
+  bigint view;
+  bi_limb x[BI_WORD_LIMBS];
+  bi_word(&view, x, true, w);
+  size_t wn = view.xlen;
+  if (an == 0 || wn == 0)
+    return 0;
+  if (wn == 1)
+    r[an] = bi_limbs_mul_1(r, a, an, x[0]);
+  else if (an >= wn)
+    bi_kern()->mul(r, a, an, x, wn);
+  else
+    bi_kern()->mul(r, x, wn, a, an);
+  return bi_limbs_normalize(r, an + wn);
+}
+
+// r = p a - q b for p a >= q b, with t for q b
+static size_t bi_limbs_comb_sub(bi_limb *r, const bi_limb *a, size_t an,
+                                uint64_t p, const bi_limb *b, size_t bn,
+                                uint64_t q, bi_limb *t) {
+  size_t rn = bi_limbs_mul_word(r, a, an, p);
+  size_t tn = bi_limbs_mul_word(t, b, bn, q);
+  bi_limbs_sub(r, r, rn, t, tn);
+  return bi_limbs_normalize(r, rn);
+}
+
+// r = p a + q b, with t for q b
+static size_t bi_limbs_comb_add(bi_limb *r, const bi_limb *a, size_t an,
+                                uint64_t p, const bi_limb *b, size_t bn,
+                                uint64_t q, bi_limb *t) {
+  size_t rn = bi_limbs_mul_word(r, a, an, p);
+  size_t tn = bi_limbs_mul_word(t, b, bn, q);
+  if (rn >= tn)
+    r[rn] = bi_limbs_add(r, r, rn, t, tn);
+  else {
+    r[tn] = bi_limbs_add(r, t, tn, r, rn);
+    rn = tn;
+  }
+  return bi_limbs_normalize(r, rn + 1);
+}
+
+// Euclid in words on the leading parts xh >= yh; m gets the matrix
+// (A B; C D) of the steps whose quotients hold for the full numbers, and
+// the number of steps is returned
+static int bi_gcd_words(uint64_t xh, uint64_t yh, int64_t m[4]) {
+  int64_t a = 1, b = 0, c = 0, d = 1;
+  int64_t x = (int64_t)xh, y = (int64_t)yh;
+  int steps = 0;
+  while (y + c != 0 && y + d != 0) {
+    int64_t q = (x + a) / (y + c);
+    if (q != (x + b) / (y + d))
+      break;
+    int64_t t = a - q * c;
+    a = c;
+    c = t;
+    t = b - q * d;
+    b = d;
+    d = t;
+    t = x - q * y;
+    x = y;
+    y = t;
+    steps++;
+  }
+  m[0] = a;
+  m[1] = b;
+  m[2] = c;
+  m[3] = d;
+  return steps;
+}
+
+// Cofactor magnitudes c[0], c[1] of the current x and y in Lehmer's loop,
+// with c[2] and c[3] spare buffers of the same size
+struct bi_cofactors {
+  bi_limb* c[4];
+  size_t n[2];
+};
+
+// c0, c1 = c1, c0 + q c1
+static bool bi_cofactors_quotient(struct bi_cofactors *f, const bigint *q) {
+  bigint cv = { true, -1, (int)f->n[1], f->n[1] ? f->c[1] : NULL, NULL };
+  bigint* qc = bi_mul(q, &cv);
+  if (!qc)
+    return false;
+  size_t n = (size_t)qc->xlen > f->n[0] ? (size_t)qc->xlen : f->n[0];
+  bi_limb* r = f->c[2];
+  memset(r, 0, (n + 1) * sizeof(bi_limb));
+  if (qc->xlen)
+    memcpy(r, qc->x, qc->xlen * sizeof(bi_limb));
+  bi_limbs_add(r, r, n + 1, f->c[0], f->n[0]);
+  bi_delete(qc);
+  f->c[2] = f->c[0];
+  f->c[0] = f->c[1];
+  f->c[1] = r;
+  f->n[0] = f->n[1];
+  f->n[1] = bi_limbs_normalize(r, n + 1);
+  return true;
+}
+
+// c0, c1 = a c0 + b c1, c c0 + d c1, with t for the products
+static void bi_cofactors_matrix(struct bi_cofactors *f, uint64_t a,
+                                uint64_t b, uint64_t c, uint64_t d,
+                                bi_limb *t) {
+  size_t n0 = bi_limbs_comb_add(f->c[2], f->c[0], f->n[0], a, f->c[1],
+                                f->n[1], b, t);
+  f->n[1] = bi_limbs_comb_add(f->c[3], f->c[0], f->n[0], c, f->c[1],
+                              f->n[1], d, t);
+  f->n[0] = n0;
+  bi_limb* tmp = f->c[0];
+  f->c[0] = f->c[2];
+  f->c[2] = tmp;
+  tmp = f->c[1];
+  f->c[1] = f->c[3];
+  f->c[3] = tmp;
+}
+
+// 2x2 matrix (m0 m1; m2 m3) of non-negative entries, a product of Euclid
+// steps (q 1; 1 0) with determinant -1 after an odd number of them. The
+// steps from a and b to x and y give (a; b) = M (x; y).
+struct bi_mat {
+  bigint* m[4];
+  bool odd;
+};
+
+static void bi_mat_clear(struct bi_mat *M) {
+  for (int i = 0; i < 4; i++) {
+    bi_delete(M->m[i]);
+    M->m[i] = NULL;
+  }
+}
+
+static bool bi_mat_identity(struct bi_mat *M) {
+  M->m[0] = bi_from_u64(1);
+  M->m[1] = bi_zero();
+  M->m[2] = bi_zero();
+  M->m[3] = bi_from_u64(1);
+  M->odd = false;
+  if (!(M->m[0] && M->m[1] && M->m[2] && M->m[3])) {
+    bi_mat_clear(M);
+    return false;
+  }
+  return true;
+}
+
+static bool bi_mat_is_identity(const struct bi_mat *M) {
+  return bi_is_zero(M->m[1]) && bi_is_zero(M->m[2]);
+}
+
+// p a + q b
+static bigint* bi_mat_dot(const bigint *p, const bigint *a, const bigint *q,
+                          const bigint *b) {
+  bigint* pa = bi_mul(p, a);
+  bigint* qb = pa ? bi_mul(q, b) : NULL;
+  bigint* retval = qb ? bi_add(pa, qb) : NULL;
+  bi_delete(pa);
+  bi_delete(qb);
+  return retval;
+}
+
+// M = M (q 1; 1 0)
+static bool bi_mat_step(struct bi_mat *M, const bigint *q) {
+  bigint* one = bi_from_u64(1);
+  bigint* m0 = one ? bi_mat_dot(q, M->m[0], one, M->m[1]) : NULL;
+  bigint* m2 = m0 ? bi_mat_dot(q, M->m[2], one, M->m[3]) : NULL;
+  bi_delete(one);
+  if (!m2) {
+    bi_delete(m0);
+    return false;
+  }
+  bi_delete(M->m[1]);
+  bi_delete(M->m[3]);
+  M->m[1] = M->m[0];
+  M->m[3] = M->m[2];
+  M->m[0] = m0;
+  M->m[2] = m2;
+  M->odd = !M->odd;
+  return true;
+}
+
+// takes the last step (q 1; 1 0) off M and returns q. Each row of M is
+// (q r0 + r1, r0) for the row (r0, r1) before, and r1 <= r0, so that
+// floor(r0 / r1) is q or q + 1; the latter only for r1 = r0, which cannot
+// hold in both rows.
+static bigint* bi_mat_unstep(struct bi_mat *M) {
+  bigint* q = NULL;
+  for (int i = 0; i < 4; i += 2) {
+    if (bi_is_zero(M->m[i + 1]))
+      continue;
+    bigint* qi = bi_div(M->m[i], M->m[i + 1]);
+    if (!qi) {
+      bi_delete(q);
+      return NULL;
+    }
+    if (!q || bi_cmp(qi, q) < 0) {
+      bi_delete(q);
+      q = qi;
+    } else
+      bi_delete(qi);
+  }
+  if (!q)
+    return NULL;
+
+  bigint* minus = bi_negate(q);
+  bigint* one = bi_from_u64(1);
+  bigint* m1 = minus && one ? bi_mat_dot(one, M->m[0], minus, M->m[1]) : NULL;
+  bigint* m3 = m1 ? bi_mat_dot(one, M->m[2], minus, M->m[3]) : NULL;
+  bi_delete(minus);
+  bi_delete(one);
+  if (!m3) {
+    bi_delete(m1);
+    bi_delete(q);
+    return NULL;
+  }
+  bi_delete(M->m[0]);
+  bi_delete(M->m[2]);
+  M->m[0] = M->m[1];
+  M->m[2] = M->m[3];
+  M->m[1] = m1;
+  M->m[3] = m3;
+  M->odd = !M->odd;
+  return q;
+}
+
+// M = M N
+static bool bi_mat_mul(struct bi_mat *M, const struct bi_mat *N) {
+  bigint* r[4];
+  for (int i = 0; i < 4; i++) {
+    int row = i & 2, col = i & 1;
+    r[i] = bi_mat_dot(M->m[row], N->m[col], M->m[row + 1], N->m[col + 2]);
+    if (!r[i]) {
+      while (i--)
+        bi_delete(r[i]);
+      return false;
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    bi_delete(M->m[i]);
+    M->m[i] = r[i];
+  }
+  M->odd ^= N->odd;
+  return true;
+}
+
+// (x; y) = M^-1 (a; b) = +-(m3 a - m1 b; m0 b - m2 a)
+static bool bi_mat_solve(const struct bi_mat *M, const bigint *a,
+                         const bigint *b, bigint **x, bigint **y) {
+  bigint* m1 = bi_negate(M->m[1]);
+  bigint* m2 = bi_negate(M->m[2]);
+  *x = m1 ? bi_mat_dot(M->m[3], a, m1, b) : NULL;
+  *y = m2 && *x ? bi_mat_dot(M->m[0], b, m2, a) : NULL;
+  bi_delete(m1);
+  bi_delete(m2);
+  if (!*y) {
+    bi_delete(*x);
+    return false;
+  }
+  if (M->odd) {
+    *x = bi_set_sign(*x, !(*x)->positive || bi_is_zero(*x));
+    *y = bi_set_sign(*y, !(*y)->positive || bi_is_zero(*y));
+  }
+  return true;
+}
+
+// Lehmer's algorithm on x0 >= y0 > 0 as magnitudes, until y has at most
+// stop limbs (stop 0 runs to the gcd); *rx and *ry get the last two
+// remainders. With M, the steps are recorded too; its top row only if full.
+static bool bi_lehmer(bigint **rx, bigint **ry, struct bi_mat *M, bool full,
+                      const bigint *x0, const bigint *y0, size_t stop) {
+  size_t size = x0->xlen + 2 * BI_WORD_LIMBS + 2;
+  int count = M ? (full ? 13 : 9) : 5;
+  bi_limb* buf = malloc(count * size * sizeof(bi_limb));
+  if (!buf)
+    return false;
+  bi_limb* x = buf;
+  bi_limb* y = buf + size;
+  bi_limb* nx = buf + 2 * size;
+  bi_limb* ny = buf + 3 * size;
+  bi_limb* t = buf + 4 * size;
+  // u for x0, v for y0: x = u0 x0 - v0 y0 up to the sign, which flips
+  // with every step
+  struct bi_cofactors u = { { NULL }, { 1, 0 } };
+  struct bi_cofactors v = { { NULL }, { 0, 1 } };
+  for (int i = 0; i < 4 && M; i++) {
+    u.c[i] = buf + (5 + i) * size;
+    if (full)
+      v.c[i] = buf + (9 + i) * size;
+  }
+  if (M)
+    u.c[0][0] = 1;
+  if (full)
+    v.c[1][0] = 1;
+  bool odd = false;
+  size_t xn = x0->xlen;
+  size_t yn = y0->xlen;
+  memcpy(x, x0->x, xn * sizeof(bi_limb));
+  memcpy(y, y0->x, yn * sizeof(bi_limb));
+
+  bool ok = true;
+  while (ok && yn > stop) {
+    size_t len = bi_gcd_length(x, xn);
+    size_t s = len > BI_GCD_WORD ? len - BI_GCD_WORD : 0;
+    int64_t m[4];
+    int steps = bi_gcd_words(bi_gcd_top(x, xn, s), bi_gcd_top(y, yn, s), m);
+
+    if (m[1] == 0) {
+      // one step with the full quotient
+      bigint xv = { true, -1, (int)xn, x, NULL };
+      bigint yv = { true, -1, (int)yn, y, NULL };
+      bigint* q;
+      bigint* r;
+      if (!bi_divrem_abs(&q, &r, &xv, &yv, NULL)) {
+        ok = false;
+        break;
+      }
+      memcpy(x, y, yn * sizeof(bi_limb));
+      xn = yn;
+      yn = r->xlen;
+      if (yn)
+        memcpy(y, r->x, yn * sizeof(bi_limb));
+      bi_delete(r);
+      if (M) {
+        ok = bi_cofactors_quotient(&u, q) &&
+             (!full || bi_cofactors_quotient(&v, q));
+        odd = !odd;
+      }
+      bi_delete(q);
+      continue;
+    }
+
+    // an even number of steps leaves A >= 0 >= B and C <= 0 <= D
+    bool even = steps % 2 == 0;
+    uint64_t a = bi_abs64(m[0]), b = bi_abs64(m[1]);
+    uint64_t c = bi_abs64(m[2]), d = bi_abs64(m[3]);
+    size_t nxn = even ? bi_limbs_comb_sub(nx, x, xn, a, y, yn, b, t)
+                      : bi_limbs_comb_sub(nx, y, yn, b, x, xn, a, t);
+    size_t nyn = even ? bi_limbs_comb_sub(ny, y, yn, d, x, xn, c, t)
+                      : bi_limbs_comb_sub(ny, x, xn, c, y, yn, d, t);
+    bi_limb* tmp = x;
+    x = nx;
+    nx = tmp;
+    tmp = y;
+    y = ny;
+    ny = tmp;
+    xn = nxn;
+    yn = nyn;
+    if (M) {
+      bi_cofactors_matrix(&u, a, b, c, d, t);
+      if (full)
+        bi_cofactors_matrix(&v, a, b, c, d, t);
+      odd ^= !even;
+    }
+  }
+
+  // x = +-(m3 x0 - m1 y0) and y = +-(m0 y0 - m2 x0) for M^-1
+  if (ok) {
+    *rx = bi_from_limbs(x, xn);
+    *ry = bi_from_limbs(y, yn);
+    if (M) {
+      M->m[0] = full ? bi_from_limbs(v.c[1], v.n[1]) : NULL;
+      M->m[1] = full ? bi_from_limbs(v.c[0], v.n[0]) : NULL;
+      M->m[2] = bi_from_limbs(u.c[1], u.n[1]);
+      M->m[3] = bi_from_limbs(u.c[0], u.n[0]);
+      M->odd = odd;
+    }
+    ok = *rx && *ry &&
+         (!M || (M->m[2] && M->m[3] && (!full || (M->m[0] && M->m[1]))));
+    if (!ok) {
+      bi_delete(*rx);
+      bi_delete(*ry);
+      if (M)
+        bi_mat_clear(M);
+    }
+  }
+  free(buf);
+  return ok;
+}
+
+// (x; y) = M^-1 (a; b) for the steps M that took a / B^k > b / B^k, a
+// and b without their k low limbs, to hx and hy; that is hx B^k, hy B^k
+// plus M^-1 applied to the low limbs. Steps are then taken off the end of
+// M until x > y > 0: a product of Euclid steps that takes a, b to such x, y
+// is a prefix of the continued fraction of a / b, so what remains are
+// Euclid's steps for a and b.
+static bool bi_hgcd_fix(struct bi_mat *M, bigint **x, bigint **y,
+                        const bigint *a, const bigint *b, const bigint *hx,
+                        const bigint *hy, size_t k) {
+  size_t an = bi_limbs_normalize(a->x, (size_t)a->xlen < k ? a->xlen : k);
+  size_t bn = bi_limbs_normalize(b->x, (size_t)b->xlen < k ? b->xlen : k);
+  bigint al = { true, -1, (int)an, an ? a->x : NULL, NULL };
+  bigint bl = { true, -1, (int)bn, bn ? b->x : NULL, NULL };
+  bigint *lx, *ly;
+  if (!bi_mat_solve(M, &al, &bl, &lx, &ly))
+    return false;
+  bigint* sx = bi_shift_limbs(hx, (long)k);
+  bigint* sy = bi_shift_limbs(hy, (long)k);
+  *x = sx ? bi_add(sx, lx) : NULL;
+  *y = sy ? bi_add(sy, ly) : NULL;
+  bi_delete(sx);
+  bi_delete(sy);
+  bi_delete(lx);
+  bi_delete(ly);
+  if (!*x || !*y) {
+    bi_delete(*x);
+    bi_delete(*y);
+    *x = *y = NULL;
+    return false;
+  }
+  while (!bi_mat_is_identity(M) &&
+         (bi_is_zero(*y) || !(*y)->positive || bi_cmp(*x, *y) <= 0)) {
+    // x, y = q x + y, x
+    bigint* q = bi_mat_unstep(M);
+    bigint* qx = q ? bi_mul(q, *x) : NULL;
+    bigint* px = qx ? bi_add(qx, *y) : NULL;
+    bi_delete(q);
+    bi_delete(qx);
+    if (!px) {
+      bi_delete(*x);
+      bi_delete(*y);
+      *x = *y = NULL;
+      return false;
+    }
+    bi_delete(*y);
+    *y = *x;
+    *x = px;
+  }
+  return true;
+}
+
+// Half-gcd of a > b > 0 with n limbs: the Euclid steps M that take b to
+// about n / 2 limbs, and the remainders x > y reached, (a; b) = M (x; y).
+// The first half of the steps comes from the top half of a and b, the
+// second from the top of what remains, both by recursion.
+static bool bi_hgcd(struct bi_mat *M, bigint **x, bigint **y, const bigint *a,
+                    const bigint *b) {
+  size_t n = a->xlen;
+  size_t s = n / 2;
+  if (!bi_mat_identity(M))
+    return false;
+  if (bi_is_zero(b) || (size_t)b->xlen <= s + 1 || bi_cmp(a, b) <= 0) {
+    *x = bi_copy(a);
+    *y = bi_copy(b);
+    if (!*x || !*y) {
+      bi_delete(*x);
+      bi_delete(*y);
+      bi_mat_clear(M);
+      return false;
+    }
+    return true;
+  }
+  if (n < BI_HGCD_THRESHOLD) {
+    bi_mat_clear(M);
+    return bi_lehmer(x, y, M, true, a, b, s + 1);
+  }
+
+  bool ok = true;
+  *x = *y = NULL;
+  for (int half = 0; ok && half < 2; half++) {
+    // the leading limbs of a and b, then of x and y, shortened so that
+    // halving them takes y down to about s limbs
+    const bigint* p = half ? *x : a;
+    const bigint* r = half ? *y : b;
+    size_t k = half ? (2 * s > (size_t)p->xlen ? 2 * s - p->xlen : 0) : s;
+    bigint* ph = bi_shift_limbs(p, -(long)k);
+    bigint* rh = bi_shift_limbs(r, -(long)k);
+    struct bi_mat H = { { NULL, NULL, NULL, NULL }, false };
+    bigint *hx, *hy, *px = NULL, *py = NULL;
+    ok = ph && rh && bi_hgcd(&H, &hx, &hy, ph, rh);
+    bi_delete(ph);
+    bi_delete(rh);
+    if (ok) {
+      ok = bi_hgcd_fix(&H, &px, &py, p, r, hx, hy, k) && bi_mat_mul(M, &H);
+      bi_delete(hx);
+      bi_delete(hy);
+    }
+    bi_mat_clear(&H);
+    bi_delete(*x);
+    bi_delete(*y);
+    *x = px;
+    *y = py;
+
+    // single divisions past unusually large quotients, so that the second
+    // half works on fewer limbs
+    while (ok && half == 0 && !bi_is_zero(*y) &&
+           (size_t)(*x)->xlen > 3 * n / 4 + 1) {
+      bigint *q, *rem;
+      ok = bi_divrem_abs(&q, &rem, *x, *y, NULL);
+      if (ok) {
+        ok = bi_mat_step(M, q);
+        bi_delete(q);
+        bi_delete(*x);
+        *x = *y;
+        *y = rem;
+      }
+    }
+    if (ok && (bi_is_zero(*y) || (size_t)(*y)->xlen <= s + 1))
+      break;
+  }
+  if (!ok) {
+    bi_delete(*x);
+    bi_delete(*y);
+    bi_mat_clear(M);
+  }
+  return ok;
+}
+
+// Reduces a >= b > 0 as magnitudes in place by half-gcds, and single
+// divisions where they make no progress, until b is below
+// BI_HGCD_THRESHOLD limbs; with T, the steps are recorded.
+static bool bi_gcd_reduce(bigint **a, bigint **b, struct bi_mat *T) {
+  while (!bi_is_zero(*b) && (*b)->xlen >= BI_HGCD_THRESHOLD) {
+    struct bi_mat M;
+    bigint *x, *y;
+    if (!bi_hgcd(&M, &x, &y, *a, *b))
+      return false;
+    bool ok = true;
+    if (bi_mat_is_identity(&M)) {
+      bi_delete(x);
+      bi_delete(y);
+      bigint* q;
+      ok = bi_divrem_abs(&q, &y, *a, *b, NULL);
+      if (ok) {
+        x = bi_copy(*b);
+        ok = x && (!T || bi_mat_step(T, q));
+        bi_delete(q);
+        if (!ok) {
+          bi_delete(x);
+          bi_delete(y);
+        }
+      }
+    } else if (T && !bi_mat_mul(T, &M)) {
+      bi_delete(x);
+      bi_delete(y);
+      ok = false;
+    }
+    bi_mat_clear(&M);
+    if (!ok)
+      return false;
+    bi_delete(*a);
+    bi_delete(*b);
+    *a = x;
+    *b = y;
+  }
+  return true;
+}
+
+bigint* bi_gcd(const bigint *a, const bigint *b) {
+  return bi_gcdext(a, b, NULL, NULL);
+}
+
+bigint* bi_gcdext(const bigint *a, const bigint *b, bigint **s, bigint **t) {
+  if (!(a && b))
+    return NULL;
+
+  // x >= y as magnitudes; s belongs to a, t to b
+  bool swap = bi_limbs_cmp(a->x, a->xlen, b->x, b->xlen) < 0;
+  const bigint* x = swap ? b : a;
+  const bigint* y = swap ? a : b;
+  bigint** sx = swap ? t : s;
+  bigint** sy = swap ? s : t;
+  bool cofactors = s || t;
+
+  bigint* g;
+  bigint* u = NULL;
+  if (bi_is_zero(y)) {
+    // gcd(x, 0) = |x| = sign(x) x
+    g = bi_set_sign(bi_copy(x), true);
+    if (cofactors)
+      u = bi_is_zero(x) ? bi_zero() : bi_from_i64(x->positive ? 1 : -1);
+    if (!g || (cofactors && !u)) {
+      bi_delete(g);
+      bi_delete(u);
+      return NULL;
+    }
+  } else {
+    // half-gcds down to Lehmer's size, steps T, then Lehmer's steps L to
+    // g = l3 xr - l1 yr up to the sign, for the reduced xr and yr
+    struct bi_mat T = { { NULL, NULL, NULL, NULL }, false };
+    struct bi_mat L = { { NULL, NULL, NULL, NULL }, false };
+    bigint* xr = bi_set_sign(bi_copy(x), true);
+    bigint* yr = bi_set_sign(bi_copy(y), true);
+    bigint* z = NULL;
+    g = NULL;
+    bool ok = xr && yr && (!cofactors || bi_mat_identity(&T)) &&
+              bi_gcd_reduce(&xr, &yr, cofactors ? &T : NULL);
+    if (ok && bi_is_zero(yr)) {
+      g = xr;
+      xr = NULL;
+      ok = !cofactors || bi_mat_identity(&L);
+    } else if (ok)
+      ok = bi_lehmer(&g, &z, cofactors ? &L : NULL, false, xr, yr, 0);
+
+    if (ok && cofactors) {
+      // L's top row from g: l1 = (l3 xr -+ g) / yr, then the cofactor of
+      // |x| in g, u = +-(l3 t3 + l1 t2)
+      if (!L.m[1]) {
+        bigint* lx = bi_mul(L.m[3], xr);
+        bigint* rest = lx ? (L.odd ? bi_add(lx, g) : bi_sub(lx, g)) : NULL;
+        L.m[1] = rest ? bi_divexact(rest, yr) : NULL;
+        bi_delete(lx);
+        bi_delete(rest);
+      }
+      u = L.m[1] ? bi_mat_dot(L.m[3], T.m[3], L.m[1], T.m[2]) : NULL;
+      // and of x
+      if (u)
+        u = bi_set_sign(u, bi_is_zero(u) || (L.odd != T.odd) == !x->positive);
+      ok = u != NULL;
+    }
+    bi_mat_clear(&T);
+    bi_mat_clear(&L);
+    bi_delete(xr);
+    bi_delete(yr);
+    bi_delete(z);
+    if (!ok) {
+      bi_delete(g);
+      return NULL;
+    }
+  }
+  if (!cofactors)
+    return g;
+
+  // v = (g - u x) / y, or 0 when y is 0
+  bigint* v;
+  if (bi_is_zero(y))
+    v = bi_zero();
+  else {
+    bigint* ux = bi_mul(u, x);
+    bigint* rest = ux ? bi_sub(g, ux) : NULL;
+    v = rest ? bi_divexact(rest, y) : NULL;
+    bi_delete(ux);
+    bi_delete(rest);
+  }
+  if (!v) {
+    bi_delete(g);
+    bi_delete(u);
+    return NULL;
+  }
+
+  if (sx)
+    *sx = u;
+  else
+    bi_delete(u);
+  if (sy)
+    *sy = v;
+  else
+    bi_delete(v);
+  return g;
+}
+
+bigint* bi_invert(const bigint *a, const bigint *m) {
+  if (!(a && m) || bi_is_zero(m))
+    return NULL;
+
+  bigint* s = NULL;
+  bigint* g = bi_gcdext(a, m, &s, NULL);
+  if (!g || !bi_is_one(g)) {
+    bi_delete(g);
+    bi_delete(s);
+    return NULL;
+  }
+  bi_delete(g);
+
+  // s a = 1 mod m; the residue of s in [0, |m|)
+  bi_modulus* mod = bi_modulus_new(m);
+  bigint* retval = mod ? bi_mod_by(mod, s) : NULL;
+  bi_modulus_delete(mod);
+  bi_delete(s);
+  return retval;
+}
+
+// Modular arithmetic
+//
+// A bi_modulus keeps |m| with its reciprocal floor(B^2k / |m|), k the length
+// of m. Products of two residues are below |m| B^k, so each one is reduced
+// by a single Barrett step: about two multiplications and no division.
+struct bi_modulus {
+  bigint* m;
+  bigint* inv;
+};
+
+bi_modulus* bi_modulus_new(const bigint *m) {
+  if (!m || bi_is_zero(m))
+    return NULL;
+
+  bi_modulus* retval = malloc(sizeof(bi_modulus));
+  if (!retval)
+    return NULL;
+  retval->m = bi_set_sign(bi_copy(m), true);
+  retval->inv = retval->m ? bi_reciprocal(retval->m) : NULL;
+  if (!retval->inv) {
+    bi_modulus_delete(retval);
+    return NULL;
+  }
+  return retval;
+}
+
+void bi_modulus_delete(bi_modulus *mod) {
+  if (mod) {
+    bi_delete(mod->m);
+    bi_delete(mod->inv);
+    free(mod);
+  }
+}
+
+// x mod m for 0 <= x < m B^k
+static bigint* bi_mod_reduce(const bi_modulus *mod, const bigint *x) {
+  if (bi_limbs_cmp(x->x, x->xlen, mod->m->x, mod->m->xlen) < 0)
+    return bi_copy(x);
+
+  bigint* q;
+  bigint* r;
+  if (!bi_divrem_barrett_step(&q, &r, x, mod->m, mod->inv))
+    return NULL;
+  bi_delete(q);
+  return r;
+}
+
+bigint* bi_mod_by(const bi_modulus *mod, const bigint *a) {
+  if (!mod || !a)
+    return NULL;
+
+  bigint* q;
+  bigint* r;
+  if (!bi_divrem_abs(&q, &r, a, mod->m, mod->inv))
+    return NULL;
+  bi_delete(q);
+
+  // least non-negative residue
+  if (a->positive || bi_is_zero(r))
+    return r;
+  bigint* retval = bi_sub(mod->m, r);
+  bi_delete(r);
+  return retval;
+}
+
+// a b mod m for residues a and b
+static bigint* bi_mod_mul(const bi_modulus *mod, const bigint *a,
+                          const bigint *b) {
+  bigint* p = bi_mul(a, b);
+  bigint* retval = p ? bi_mod_reduce(mod, p) : NULL;
+  bi_delete(p);
+  return retval;
+}
+
+bigint* bi_mulmod_by(const bi_modulus *mod, const bigint *a, const bigint *b) {
+  if (!mod || !a || !b)
+    return NULL;
+
+  bigint* ra = bi_mod_by(mod, a);
+  bigint* rb = bi_mod_by(mod, b);
+  bigint* retval = ra && rb ? bi_mod_mul(mod, ra, rb) : NULL;
+  bi_delete(ra);
+  bi_delete(rb);
+  return retval;
+}
+
+// the bits of |e| from the least significant, in 64-bit words; *n gets the
+// bit length
+static uint64_t* bi_bits(const bigint *e, size_t *n) {
+  size_t len = e->xlen;
+  uint64_t* w = calloc(len + 1, sizeof(uint64_t));
+  if (!w)
+    return NULL;
+#if defined(BI_BINARY)
+  memcpy(w, e->x, len * sizeof(bi_limb));
+#else
+  // a limb holds fewer than 64 bits, so len words are enough
+  bi_limb* t = malloc((len + 1) * sizeof(bi_limb));
+  if (!t) {
+    free(w);
+    return NULL;
+  }
+  memcpy(t, e->x, len * sizeof(bi_limb));
+  for (size_t i = 0; len > 0; i++) {
+    uint64_t c = bi_limbs_divrem_1(t, t, len, (bi_limb)1 << 16);
+    len = bi_limbs_normalize(t, len);
+    w[i / 4] |= c << (16 * (i % 4));
+  }
+  free(t);
+  len = e->xlen;
+#endif
+  while (len > 0 && !w[len - 1])
+    len--;
+  *n = len ? 64 * len - __builtin_clzll(w[len - 1]) : 0;
+  return w;
+}
+
+// a^e mod m by left-to-right sliding windows, as in bi_pow_abs
+bigint* bi_powmod_by(const bi_modulus *mod, const bigint *a, const bigint *e) {
+  if (!mod || !a || !e || !e->positive)
+    return NULL;
+
+  bigint view;
+  bi_limb x[BI_WORD_LIMBS];
+  if (bi_is_zero(e))
+    return bi_mod_by(mod, bi_word(&view, x, true, 1));
+
+  size_t bits;
+  uint64_t* w = bi_bits(e, &bits);
+  bigint* base = w ? bi_mod_by(mod, a) : NULL;
+  if (!base) {
+    free(w);
+    return NULL;
+  }
+
+  int k = bits > 671 ? 6 : bits > 239 ? 5 : bits > 79 ? 4 :
+          bits > 23 ? 3 : bits > 6 ? 2 : 1;
+
+  // odd powers base^(2j + 1) for j < 2^(k - 1)
+  bigint* odd[32] = { base };
+  bigint* base2 = k > 1 ? bi_mod_mul(mod, base, base) : NULL;
+  bool ok = k == 1 || base2;
+  for (int j = 1; ok && j < 1 << (k - 1); j++)
+    ok = (odd[j] = bi_mod_mul(mod, odd[j - 1], base2)) != NULL;
+
+  bigint* retval = NULL;
+  for (long i = (long)bits - 1; ok && i >= 0;) {
+    if (!(w[i / 64] >> (i % 64) & 1)) {
+      bigint* next = bi_mod_mul(mod, retval, retval);
+      bi_delete(retval);
+      ok = (retval = next) != NULL;
+      i--;
+      continue;
+    }
+
+    // the longest window of at most k bits from bit i down ending in a one
+    long j = i - k + 1 < 0 ? 0 : i - k + 1;
+    while (!(w[j / 64] >> (j % 64) & 1))
+      j++;
+    size_t v = 0;
+    for (long t = i; t >= j; t--)
+      v = v << 1 | (w[t / 64] >> (t % 64) & 1);
+
+    if (!retval)
+      ok = (retval = bi_copy(odd[v / 2])) != NULL;
+    else {
+      for (long t = i; ok && t >= j; t--) {
+        bigint* next = bi_mod_mul(mod, retval, retval);
+        bi_delete(retval);
+        ok = (retval = next) != NULL;
+      }
+      if (ok) {
+        bigint* next = bi_mod_mul(mod, retval, odd[v / 2]);
+        bi_delete(retval);
+        ok = (retval = next) != NULL;
+      }
+    }
+    i = j - 1;
+  }
+
+  for (int j = 0; j < 32; j++)
+    bi_delete(odd[j]);
+  bi_delete(base2);
+  free(w);
+  if (!ok) {
+    bi_delete(retval);
+    return NULL;
+  }
+  return retval;
+}
+
+bigint* bi_powmod(const bigint *a, const bigint *e, const bigint *m) {
+  bi_modulus* mod = bi_modulus_new(m);
+  bigint* retval = bi_powmod_by(mod, a, e);
+  bi_modulus_delete(mod);
+  return retval;
+}
+
+#if defined(BI_BINARY)
+// Radix conversion
+//
+// Chunk arrays are split in halves around P_j = (10^19)^(2^j): parsing
+// multiplies the high half by P_j, formatting divides by P_j using its
+// reciprocal. Short arrays use the quadratic loops.
+#define BI_CONVERT_THRESHOLD 32
+
+// Power cache
+//
+// Conversions of similar sizes need the same powers and reciprocals, so they
+// are kept for the life of the process and grown as conversions ask for
+// them. Entries are built outside the lock; one that would take the cache
+// over BI_POWCACHE_MAX_BYTES belongs to the conversion that built it.
+// bi_powcache_clear() waits until no conversion holds entries.
+#ifndef BI_POWCACHE_MAX_BYTES
+#define BI_POWCACHE_MAX_BYTES ((size_t)64 << 20)
+#endif
+
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t idle;
+  bigint* pow[64];
+  bigint* inv[64];
+  size_t bytes;
+  int users;
+} bi_powcache = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+                { NULL }, { NULL }, 0, 0 };
+
+// short conversions never touch the cache or its lock
+static void bi_powers_init(struct bi_powers *pw) {
+  memset(pw, 0, sizeof(*pw));
+}
+
+static void bi_powers_free(struct bi_powers *pw) {
+  for (size_t j = 0; j < 64; j++) {
+    if (pw->own_pow >> j & 1)
+      bi_delete(pw->pow[j]);
+    if (pw->own_inv >> j & 1)
+      bi_delete(pw->inv[j]);
+  }
+
+  if (pw->user) {
+    pthread_mutex_lock(&bi_powcache.lock);
+    if (--bi_powcache.users == 0)
+      pthread_cond_broadcast(&bi_powcache.idle);
+    pthread_mutex_unlock(&bi_powcache.lock);
+  }
+}
+
+// P_j, or its reciprocal when inv is set
+static const bigint* bi_powers_entry(struct bi_powers *pw, size_t j, bool inv) {
+  bigint** slot = inv ? pw->inv : pw->pow;
+  bigint** shared = inv ? bi_powcache.inv : bi_powcache.pow;
+  if (slot[j])
+    return slot[j];
+
+  pthread_mutex_lock(&bi_powcache.lock);
+  if (!pw->user) {
+    pw->user = true;
+    bi_powcache.users++;
+  }
+  slot[j] = shared[j];
+  pthread_mutex_unlock(&bi_powcache.lock);
+  if (slot[j])
+    return slot[j];
+
+  bigint* e;
+  if (inv) {
+    const bigint* p = bi_powers_entry(pw, j, false);
+    e = p ? bi_reciprocal(p) : NULL;
+  } else if (j == 0) {
+    bi_limb chunk_base = BI_CHUNK_BASE;
+    e = bi_from_limbs(&chunk_base, 1);
+  } else {
+    const bigint* p = bi_powers_entry(pw, j - 1, false);
+    e = p ? bi_mul(p, p) : NULL;
+  }
+  if (!e)
+    return NULL;
+
+  size_t bytes = sizeof(bigint) + e->xlen * sizeof(bi_limb);
+  pthread_mutex_lock(&bi_powcache.lock);
+  if (shared[j]) {
+    // built by another conversion in the meantime
+    bi_delete(e);
+    e = shared[j];
+  } else if (bi_powcache.bytes + bytes <= BI_POWCACHE_MAX_BYTES) {
+    shared[j] = e;
+    bi_powcache.bytes += bytes;
+  } else if (inv)
+    pw->own_inv |= (uint64_t)1 << j;
+  else
+    pw->own_pow |= (uint64_t)1 << j;
+  pthread_mutex_unlock(&bi_powcache.lock);
+
+  slot[j] = e;
+  return e;
+}
+
+static const bigint* bi_power(struct bi_powers *pw, size_t j) {
+  return bi_powers_entry(pw, j, false);
+}
+
+static const bigint* bi_power_inv(struct bi_powers *pw, size_t j) {
+  return bi_powers_entry(pw, j, true);
+}
+
+// value of n base 10^19 chunks, least significant first
+static bigint* bi_from_chunks_dc(const bi_limb *chunks, size_t n,
+                                 struct bi_powers *pw) {
+  if (n <= BI_CONVERT_THRESHOLD) {
+    bigint* retval = bi_alloc(n);
+    if (!retval)
+      return NULL;
+    retval->xlen = (int)bi_from_chunks(retval->x, chunks, n);
+    return bi_normalize(retval);
+  }
+
+  // 2^j < n <= 2^(j + 1)
+  size_t j = 0;
+  while (((size_t)2 << j) < n)
+    j++;
+  size_t half = (size_t)1 << j;
+
+  bigint* lo = bi_from_chunks_dc(chunks, half, pw);
+  bigint* hi = bi_from_chunks_dc(chunks + half, n - half, pw);
+  const bigint* p = bi_power(pw, j);
+  bigint* shifted = p ? bi_mul(hi, p) : NULL;
+  bigint* retval = bi_add(shifted, lo);
+  bi_delete(lo);
+  bi_delete(hi);
+  bi_delete(shifted);
+  return retval;
+}
+
+// x as base 10^19 chunks, least significant first and zero-padded to at
+// least pad chunks; the chunk count goes to *n
+static bool bi_to_chunks_dc(bi_limb *chunks, size_t *n, const bigint *x,
+                            size_t pad, struct bi_powers *pw) {
+  size_t count = 0;
+  if (x->xlen <= BI_CONVERT_THRESHOLD) {
+    if (x->xlen > 0) {
+      bi_limb* tmp = malloc(x->xlen * sizeof(bi_limb));
+      if (!tmp)
+        return false;
+      memcpy(tmp, x->x, x->xlen * sizeof(bi_limb));
+      count = bi_to_chunks(chunks, tmp, x->xlen);
+      free(tmp);
+    }
+    for (; count < pad; count++)
+      chunks[count] = 0;
+    *n = count;
+    return true;
+  }
+
+  // P_j has a little under 2^j limbs; take one about half as long as x
+  size_t j = 0;
+  while (((size_t)4 << j) <= (size_t)x->xlen)
+    j++;
+  const bigint* p = bi_power(pw, j);
+  if (!p)
+    return false;
+  bool use_inv = bi_div_uses_reciprocal(x->xlen, p->xlen);
+  const bigint* inv = use_inv ? bi_power_inv(pw, j) : NULL;
+  if (use_inv && !inv)
+    return false;
+
+  bigint* q;
+  bigint* r;
+  if (!bi_divrem_abs(&q, &r, x, p, inv))
+    return false;
+
+  size_t half = (size_t)1 << j;
+  size_t nlo;
+  size_t nhi;
+  bool ok = bi_to_chunks_dc(chunks, &nlo, r, half, pw) &&
+            bi_to_chunks_dc(chunks + half, &nhi, q,
+                            pad > half ? pad - half : 0, pw);
+  bi_delete(q);
+  bi_delete(r);
+  *n = half + nhi;
+  return ok;
+}
+#endif
+
+void bi_powcache_clear(void) {
+#if defined(BI_BINARY)
+  pthread_mutex_lock(&bi_powcache.lock);
+  while (bi_powcache.users > 0)
+    pthread_cond_wait(&bi_powcache.idle, &bi_powcache.lock);
+  for (size_t j = 0; j < 64; j++) {
+    bi_delete(bi_powcache.pow[j]);
+    bi_delete(bi_powcache.inv[j]);
+    bi_powcache.pow[j] = NULL;
+    bi_powcache.inv[j] = NULL;
+  }
+  bi_powcache.bytes = 0;
+  pthread_mutex_unlock(&bi_powcache.lock);
+#endif
+}
+
+size_t bi_powcache_size(void) {
+#if defined(BI_BINARY)
+  pthread_mutex_lock(&bi_powcache.lock);
+  size_t bytes = bi_powcache.bytes;
+  pthread_mutex_unlock(&bi_powcache.lock);
+  return bytes;
+#else
+  return 0;
+#endif
+}
+
+// Kernel implementations
+//
+// Every kernel has a portable version. On x86 the CPU is probed once at
+// startup and the widest supported version is used; setting BI_KERNEL to
+// generic, avx2 or avx512 in the environment forces a path instead.
+
+static inline bi_limb bi_add_n_carry(bi_limb *r, const bi_limb *a,
+                                     const bi_limb *b, size_t n, bi_limb carry) {
+  for (size_t i = 0; i < n; i++)
+    carry = bi_addc(&r[i], a[i], b[i], carry);
+  return carry;
+}
+
+static inline bi_limb bi_sub_n_borrow(bi_limb *r, const bi_limb *a,
+                                      const bi_limb *b, size_t n, bi_limb borrow) {
+  for (size_t i = 0; i < n; i++)
+    borrow = bi_subb(&r[i], a[i], b[i], borrow);
+  return borrow;
+}
+
+static bi_limb bi_add_n_generic(bi_limb *r, const bi_limb *a,
+                                const bi_limb *b, size_t n) {
+  return bi_add_n_carry(r, a, b, n, 0);
+}
+
+static bi_limb bi_sub_n_generic(bi_limb *r, const bi_limb *a,
+                                const bi_limb *b, size_t n) {
+  return bi_sub_n_borrow(r, a, b, n, 0);
+}
+
+static void bi_add_wide_generic(bi_dlimb *acc, const bi_limb *a, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    acc[i] += a[i];
+}
+
+#if defined(BI_BINARY)
+// Long multiplication, one row of b at a time
+static void bi_mul_generic(bi_limb *r, const bi_limb *a, size_t an,
+                           const bi_limb *b, size_t bn) {
+  r[an] = bi_limbs_mul_1(r, a, an, b[0]);
+  for (size_t ib = 1; ib < bn; ib++)
+    r[ib + an] = bi_limbs_addmul_1(r + ib, a, an, b[ib]);
+}
+
+// The same rows added into or subtracted from r, each row's carry running
+// up only as far as it changes r
+static bi_limb bi_addmul_generic(bi_limb *r, const bi_limb *a, size_t an,
+                                 const bi_limb *b, size_t bn) {
+  bi_limb carry = 0;
+  for (size_t ib = 0; ib < bn; ib++) {
+    bi_limb c = bi_limbs_addmul_1(r + ib, a, an, b[ib]);
+    carry += bi_limbs_add_1(r + ib + an, r + ib + an, bn - ib, c);
+  }
+  return carry;
+}
+
+static bi_limb bi_submul_generic(bi_limb *r, const bi_limb *a, size_t an,
+                                 const bi_limb *b, size_t bn) {
+  bi_limb borrow = 0;
+  for (size_t ib = 0; ib < bn; ib++) {
+    bi_limb c = bi_limbs_submul_1(r + ib, a, an, b[ib]);
+    borrow += bi_limbs_sub_1(r + ib + an, r + ib + an, bn - ib, c);
+  }
+  return borrow;
+}
+#else
+// Long multiplication with deferred carries
+//
+// Rows of b are added into double-limb column sums BI_MUL_ROWS at a time,
+// which keeps the inner loop (the row kernel) free of divisions and carries;
+// 16 products of two limbs still fit in a double limb in both decimal bases.
+// a is walked in blocks of BI_MUL_COLS limbs so the column sums stay on the
+// stack. Folding the sums into r rather than into zeros gives r += a b, and
+// taking them off gives r -= a b, in the same single pass.
+#define BI_MUL_ROWS 16
+#define BI_MUL_COLS 256
+
+typedef void (*bi_mul_row_fn)(bi_dlimb *, const bi_limb *, size_t, bi_dlimb);
+
+static void bi_mul_row_generic(bi_dlimb *acc, const bi_limb *a, size_t n,
+                               bi_dlimb b) {
+  bi_limb bl = (bi_limb)b;
+  for (size_t i = 0; i < n; i++)
+    acc[i] += (bi_dlimb)a[i] * bl;
+}
+
+// r (+/-)= v + carry for a column sum v, returning the carry (borrow) out
+static inline bi_dlimb bi_mul_fold(bi_limb *r, bi_dlimb v, bi_dlimb carry,
+                                   bool sub) {
+  if (!sub)
+    return bi_split_wide(v + *r + carry, r);
+  bi_limb lo;
+  carry = bi_split_wide(v + carry, &lo);
+  return carry + bi_subb(r, *r, lo, 0);
+}
+
+// r = a b for sign 0, r += a b for sign 1 and r -= a b for sign -1 over
+// an + bn limbs, returning the carry (borrow) out of the top one
+static bi_limb bi_mul_body(bi_limb *r, const bi_limb *a, size_t an,
+                           const bi_limb *b, size_t bn, bi_mul_row_fn row,
+                           int sign) {
+  bi_dlimb acc[BI_MUL_COLS + BI_MUL_ROWS];
+  bi_dlimb pending[BI_MUL_ROWS];
+  bool sub = sign < 0;
+  bi_limb out = 0;
+
+  if (sign == 0)
+    memset(r, 0, (an + bn) * sizeof(bi_limb));
+  for (size_t j0 = 0; j0 < bn; j0 += BI_MUL_ROWS) {
+    size_t rows = bn - j0 < BI_MUL_ROWS ? bn - j0 : BI_MUL_ROWS;
+    bi_limb* rj = r + j0;
+    bi_dlimb carry = 0;
+    memset(pending, 0, sizeof(pending));
+
+    for (size_t i0 = 0; i0 < an; i0 += BI_MUL_COLS) {
+      size_t cols = an - i0 < BI_MUL_COLS ? an - i0 : BI_MUL_COLS;
+      memcpy(acc, pending, (rows - 1) * sizeof(bi_dlimb));
+      memset(acc + rows - 1, 0, cols * sizeof(bi_dlimb));
+
+      for (size_t j = 0; j < rows; j++)
+        row(acc + j, a + i0, cols, b[j0 + j]);
+
+      // the low cols columns have all their products from this block of rows
+      for (size_t i = 0; i < cols; i++)
+        carry = bi_mul_fold(&rj[i0 + i], acc[i], carry, sub);
+      memcpy(pending, acc + cols, (rows - 1) * sizeof(bi_dlimb));
+    }
+
+    for (size_t t = 0; t + 1 < rows; t++)
+      carry = bi_mul_fold(&rj[an + t], pending[t], carry, sub);
+    for (size_t i = j0 + an + rows - 1; carry && i < an + bn; i++)
+      carry = bi_mul_fold(&r[i], 0, carry, sub);
+    out += (bi_limb)carry;
+  }
+  return out;
+}
+
+static void bi_mul_generic(bi_limb *r, const bi_limb *a, size_t an,
+                           const bi_limb *b, size_t bn) {
+  bi_mul_body(r, a, an, b, bn, bi_mul_row_generic, 0);
+}
+
+static bi_limb bi_addmul_generic(bi_limb *r, const bi_limb *a, size_t an,
+                                 const bi_limb *b, size_t bn) {
+  return bi_mul_body(r, a, an, b, bn, bi_mul_row_generic, 1);
+}
+
+static bi_limb bi_submul_generic(bi_limb *r, const bi_limb *a, size_t an,
+                                 const bi_limb *b, size_t bn) {
+  return bi_mul_body(r, a, an, b, bn, bi_mul_row_generic, -1);
+}
+#endif
+
+// 8 ASCII digits to their value
+static inline bi_limb bi_parse8(const char *s) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  // pairs, then quads, then the whole word, each with one multiply
+  uint64_t v;
+  memcpy(&v, s, 8);
+  v -= 0x3030303030303030ULL;
+  v = v * 10 + (v >> 8);
+  v = ((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)) +
+       ((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32))) >> 32;
+  return (bi_limb)v;
+#else
+  bi_limb v = 0;
+  for (int i = 0; i < 8; i++)
+    v = v * 10 + (bi_limb)(s[i] - '0');
+  return v;
+#endif
+}
+
+static void bi_parse_generic(bi_limb *x, const char *s, size_t n) {
+  for (size_t k = 0; k < n; k++, s += BI_CHUNK_DIGITS) {
+    bi_limb v = 0;
+    int i = 0;
+    for (; i < BI_CHUNK_DIGITS % 8; i++)
+      v = v * 10 + (bi_limb)(s[i] - '0');
+    for (; i < BI_CHUNK_DIGITS; i += 8)
+      v = v * 100000000 + bi_parse8(s + i);
+    x[n - 1 - k] = v;
+  }
+}
+
+static const char bi_digit_pairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static void bi_format_generic(char *out, const bi_limb *x, size_t n) {
+  for (size_t k = 0; k < n; k++, out += BI_CHUNK_DIGITS) {
+    bi_limb v = x[n - 1 - k];
+    for (int i = BI_CHUNK_DIGITS - 2; i >= 0; i -= 2) {
+      bi_limb q = v / 100;
+      memcpy(out + i, bi_digit_pairs + 2 * (v - 100 * q), 2);
+      v = q;
+    }
+    if (BI_CHUNK_DIGITS & 1)
+      out[0] = (char)('0' + v);
+  }
+}
+
+#if defined(BI_BINARY)
+// Radix conversion between base 10^19 chunks and binary limbs
+
+// Horner's rule from the most significant chunk; x needs n limbs
+static size_t bi_from_chunks(bi_limb *x, const bi_limb *chunks, size_t n) {
+  size_t xlen = 0;
+  for (size_t k = n; k-- > 0;) {
+    bi_limb carry = chunks[k];
+    for (size_t i = 0; i < xlen; i++)
+      carry = bi_split((bi_dlimb)x[i] * BI_CHUNK_BASE + carry, &x[i]);
+    if (carry)
+      x[xlen++] = carry;
+  }
+  return xlen;
+}
+
+// repeated division by 10^19, destroying x; returns the number of chunks
+static size_t bi_to_chunks(bi_limb *chunks, bi_limb *x, size_t xlen) {
+  size_t n = 0;
+  while (xlen > 0) {
+    chunks[n++] = bi_limbs_divrem_1(x, x, xlen, BI_CHUNK_BASE);
+    xlen = bi_limbs_normalize(x, xlen);
+  }
+  return n;
+}
+#endif
+
+#if defined(BI_X86_KERNELS)
+// AVX2 kernels
+//
+// add/sub handle 8 limbs per step. Each lane is reduced on its own first; a
+// lane then either generates a carry (g), passes an incoming one on because
+// it holds BASE - 1 (p), or absorbs it. The carries into all lanes are
+// resolved at once from the g and p bit masks: ((g << 1) + p + carry) ^ p
+// ripples exactly like the carry chain would, and the bit above the top lane
+// is the carry out of the block.
+
+__attribute__((target("avx2")))
+static inline __m256i bi_avx2_lanemask(unsigned bits) {
+  const __m256i lanebits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+  __m256i m = _mm256_and_si256(_mm256_set1_epi32((int)bits), lanebits);
+  return _mm256_cmpeq_epi32(m, lanebits);
+}
+
+__attribute__((target("avx2")))
+static bi_limb bi_add_n_avx2(bi_limb *r, const bi_limb *a,
+                             const bi_limb *b, size_t n) {
+  const __m256i base = _mm256_set1_epi32(BASE);
+  const __m256i basem1 = _mm256_set1_epi32(BASE - 1);
+  unsigned carry = 0;
+  size_t i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+    __m256i sum = _mm256_add_epi32(va, vb);
+    __m256i g = _mm256_cmpgt_epi32(sum, basem1);
+    sum = _mm256_sub_epi32(sum, _mm256_and_si256(g, base));
+    __m256i p = _mm256_cmpeq_epi32(sum, basem1);
+
+    unsigned gbits = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(g));
+    unsigned pbits = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(p));
+    unsigned x = (gbits << 1) + pbits + carry;
+    unsigned cbits = (x ^ pbits) & 0xff;
+    carry = x >> 8;
+
+    // add the incoming carries, wrapping BASE - 1 lanes to zero
+    __m256i c = bi_avx2_lanemask(cbits);
+    sum = _mm256_sub_epi32(sum, c);
+    sum = _mm256_andnot_si256(_mm256_cmpeq_epi32(sum, base), sum);
+    _mm256_storeu_si256((__m256i *)(r + i), sum);
+  }
+  return bi_add_n_carry(r + i, a + i, b + i, n - i, carry);
+}
+
+__attribute__((target("avx2")))
+static bi_limb bi_sub_n_avx2(bi_limb *r, const bi_limb *a,
+                             const bi_limb *b, size_t n) {
+  const __m256i base = _mm256_set1_epi32(BASE);
+  const __m256i zero = _mm256_setzero_si256();
+  unsigned borrow = 0;
+  size_t i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+    __m256i diff = _mm256_sub_epi32(va, vb);
+    __m256i g = _mm256_cmpgt_epi32(zero, diff);
+    diff = _mm256_add_epi32(diff, _mm256_and_si256(g, base));
+    __m256i p = _mm256_cmpeq_epi32(diff, zero);
+
+    unsigned gbits = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(g));
+    unsigned pbits = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(p));
+    unsigned x = (gbits << 1) + pbits + borrow;
+    unsigned bbits = (x ^ pbits) & 0xff;
+    borrow = x >> 8;
+
+    // subtract the incoming borrows, wrapping -1 lanes to BASE - 1
+    __m256i bw = bi_avx2_lanemask(bbits);
+    diff = _mm256_add_epi32(diff, bw);
+    diff = _mm256_add_epi32(diff, _mm256_and_si256(_mm256_cmpgt_epi32(zero, diff), base));
+    _mm256_storeu_si256((__m256i *)(r + i), diff);
+  }
+  return bi_sub_n_borrow(r + i, a + i, b + i, n - i, borrow);
+}
+
+__attribute__((target("avx2")))
+static void bi_mul_row_avx2(bi_dlimb *acc, const bi_limb *a, size_t n,
+                            bi_dlimb b) {
+  const __m256i vb = _mm256_set1_epi64x((long long)b);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i va = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(a + i)));
+    __m256i s = _mm256_loadu_si256((const __m256i *)(acc + i));
+    s = _mm256_add_epi64(s, _mm256_mul_epu32(va, vb));
+    _mm256_storeu_si256((__m256i *)(acc + i), s);
+  }
+  bi_mul_row_generic(acc + i, a + i, n - i, b);
+}
+
+__attribute__((target("avx2")))
+static void bi_add_wide_avx2(bi_dlimb *acc, const bi_limb *a, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i va = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(a + i)));
+    __m256i s = _mm256_loadu_si256((const __m256i *)(acc + i));
+    _mm256_storeu_si256((__m256i *)(acc + i), _mm256_add_epi64(s, va));
+  }
+  bi_add_wide_generic(acc + i, a + i, n - i);
+}
+
+static void bi_mul_avx2(bi_limb *r, const bi_limb *a, size_t an,
+                        const bi_limb *b, size_t bn) {
+  bi_mul_body(r, a, an, b, bn, bi_mul_row_avx2, 0);
+}
+
+static bi_limb bi_addmul_avx2(bi_limb *r, const bi_limb *a, size_t an,
+                            const bi_limb *b, size_t bn) {
+  return bi_mul_body(r, a, an, b, bn, bi_mul_row_avx2, 1);
+}
+
+static bi_limb bi_submul_avx2(bi_limb *r, const bi_limb *a, size_t an,
+                            const bi_limb *b, size_t bn) {
+  return bi_mul_body(r, a, an, b, bn, bi_mul_row_avx2, -1);
+}
+
+// 4 octets per step: digit pairs, quads and the low 8 digits with
+// multiply-adds, then the leading digit of each octet on top
+__attribute__((target("avx2")))
+static void bi_parse_avx2(bi_limb *x, const char *s, size_t n) {
+  const __m256i zeros = _mm256_set1_epi8('0');
+  const __m256i w10 = _mm256_set1_epi16(0x010a);
+  const __m256i w100 = _mm256_set1_epi32(0x00010064);
+  const __m256i w1e4 = _mm256_set1_epi64x(10000);
+  const __m256i w1e8 = _mm256_set1_epi64x(100000000);
+  const __m256i pack = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  size_t k = 0;
+
+  for (; k + 4 <= n; k += 4) {
+    // lane 0 takes the least significant of the 4 octets
+    const char* c = s + 9 * k;
+    uint64_t q[4];
+    for (int l = 0; l < 4; l++)
+      memcpy(&q[l], c + 9 * (3 - l) + 1, 8);
+
+    __m256i v = _mm256_loadu_si256((const __m256i *)q);
+    v = _mm256_sub_epi8(v, zeros);
+    v = _mm256_maddubs_epi16(v, w10);
+    v = _mm256_madd_epi16(v, w100);
+    v = _mm256_add_epi64(_mm256_mul_epu32(v, w1e4), _mm256_srli_epi64(v, 32));
+    __m256i lead = _mm256_setr_epi64x(c[27] - '0', c[18] - '0', c[9] - '0', c[0] - '0');
+    v = _mm256_add_epi64(v, _mm256_mul_epu32(lead, w1e8));
+    v = _mm256_permutevar8x32_epi32(v, pack);
+    _mm_storeu_si128((__m128i *)(x + n - 4 - k), _mm256_castsi256_si128(v));
+  }
+  bi_parse_generic(x, s + 9 * k, n - k);
+}
+
+// 4 octets per step: each octet is split into its leading digit and four
+// digit pairs with multiply-shift division, then into tens and units bytes
+__attribute__((target("avx2")))
+static void bi_format_avx2(char *out, const bi_limb *x, size_t n) {
+  const __m256i m1e8 = _mm256_set1_epi64x(2882303762);  // 2^58 / 10^8
+  const __m256i m1e4 = _mm256_set1_epi64x(3518437209);  // 2^45 / 10^4
+  const __m256i m100 = _mm256_set1_epi64x(5243);        // 2^19 / 100
+  const __m256i w1e8 = _mm256_set1_epi64x(100000000);
+  const __m256i w1e4 = _mm256_set1_epi64x(10000);
+  const __m256i w100 = _mm256_set1_epi64x(100);
+  const __m256i m10 = _mm256_set1_epi16(103);           // 2^10 / 10
+  const __m256i w10 = _mm256_set1_epi16(10);
+  const __m256i zeros = _mm256_set1_epi8('0');
+  size_t k = 0;
+
+  for (; k + 4 <= n; k += 4) {
+    // lane 0 holds the least significant of the 4 octets
+    __m256i v = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(x + n - 4 - k)));
+    __m256i lead = _mm256_srli_epi64(_mm256_mul_epu32(v, m1e8), 58);
+    v = _mm256_sub_epi64(v, _mm256_mul_epu32(lead, w1e8));
+    __m256i hi = _mm256_srli_epi64(_mm256_mul_epu32(v, m1e4), 45);
+    __m256i lo = _mm256_sub_epi64(v, _mm256_mul_epu32(hi, w1e4));
+    __m256i p1 = _mm256_srli_epi64(_mm256_mul_epu32(hi, m100), 19);
+    __m256i p2 = _mm256_sub_epi64(hi, _mm256_mul_epu32(p1, w100));
+    __m256i p3 = _mm256_srli_epi64(_mm256_mul_epu32(lo, m100), 19);
+    __m256i p4 = _mm256_sub_epi64(lo, _mm256_mul_epu32(p3, w100));
+
+    // one digit pair per 16-bit lane, most significant first
+    __m256i w = _mm256_or_si256(_mm256_or_si256(p1, _mm256_slli_epi64(p2, 16)),
+                                _mm256_or_si256(_mm256_slli_epi64(p3, 32),
+                                                _mm256_slli_epi64(p4, 48)));
+    __m256i tens = _mm256_srli_epi16(_mm256_mullo_epi16(w, m10), 10);
+    __m256i units = _mm256_sub_epi16(w, _mm256_mullo_epi16(tens, w10));
+    __m256i d = _mm256_add_epi8(_mm256_or_si256(tens, _mm256_slli_epi16(units, 8)), zeros);
+
+    uint64_t digits[4];
+    uint64_t leads[4];
+    _mm256_storeu_si256((__m256i *)digits, d);
+    _mm256_storeu_si256((__m256i *)leads, lead);
+    for (int l = 0; l < 4; l++) {
+      char* o = out + 9 * (k + 3 - l);
+      o[0] = (char)('0' + leads[l]);
+      memcpy(o + 1, &digits[l], 8);
+    }
+  }
+  bi_format_generic(out + 9 * k, x, n - k);
+}
+
+// AVX-512 kernels, 16 limbs per step with the carries resolved as above
+__attribute__((target("avx512f")))
+static bi_limb bi_add_n_avx512(bi_limb *r, const bi_limb *a,
+                               const bi_limb *b, size_t n) {
+  const __m512i base = _mm512_set1_epi32(BASE);
+  const __m512i basem1 = _mm512_set1_epi32(BASE - 1);
+  const __m512i one = _mm512_set1_epi32(1);
+  const __m512i zero = _mm512_setzero_si512();
+  unsigned carry = 0;
+  size_t i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    __m512i va = _mm512_loadu_si512((const void *)(a + i));
+    __m512i vb = _mm512_loadu_si512((const void *)(b + i));
+    __m512i sum = _mm512_add_epi32(va, vb);
+    __mmask16 g = _mm512_cmpgt_epu32_mask(sum, basem1);
+    sum = _mm512_mask_sub_epi32(sum, g, sum, base);
+    __mmask16 p = _mm512_cmpeq_epi32_mask(sum, basem1);
+
+    unsigned x = ((unsigned)g << 1) + p + carry;
+    __mmask16 c = (__mmask16)(x ^ p);
+    carry = x >> 16;
+
+    sum = _mm512_mask_add_epi32(sum, c, sum, one);
+    sum = _mm512_mask_mov_epi32(sum, c & p, zero);
+    _mm512_storeu_si512((void *)(r + i), sum);
+  }
+  return bi_add_n_carry(r + i, a + i, b + i, n - i, carry);
+}
+
+__attribute__((target("avx512f")))
+static bi_limb bi_sub_n_avx512(bi_limb *r, const bi_limb *a,
+                               const bi_limb *b, size_t n) {
+  const __m512i base = _mm512_set1_epi32(BASE);
+  const __m512i basem1 = _mm512_set1_epi32(BASE - 1);
+  const __m512i one = _mm512_set1_epi32(1);
+  const __m512i zero = _mm512_setzero_si512();
+  unsigned borrow = 0;
+  size_t i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    __m512i va = _mm512_loadu_si512((const void *)(a + i));
+    __m512i vb = _mm512_loadu_si512((const void *)(b + i));
+    __m512i diff = _mm512_sub_epi32(va, vb);
+    __mmask16 g = _mm512_cmpgt_epu32_mask(vb, va);
+    diff = _mm512_mask_add_epi32(diff, g, diff, base);
+    __mmask16 p = _mm512_cmpeq_epi32_mask(diff, zero);
+
+    unsigned x = ((unsigned)g << 1) + p + borrow;
+    __mmask16 bw = (__mmask16)(x ^ p);
+    borrow = x >> 16;
+
+    diff = _mm512_mask_sub_epi32(diff, bw, diff, one);
+    diff = _mm512_mask_mov_epi32(diff, bw & p, basem1);
+    _mm512_storeu_si512((void *)(r + i), diff);
+  }
+  return bi_sub_n_borrow(r + i, a + i, b + i, n - i, borrow);
+}
+
+__attribute__((target("avx512f")))
+static void bi_mul_row_avx512(bi_dlimb *acc, const bi_limb *a, size_t n,
+                              bi_dlimb b) {
+  const __m512i vb = _mm512_set1_epi64((long long)b);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512i va = _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i *)(a + i)));
+    __m512i s = _mm512_loadu_si512((const void *)(acc + i));
+    s = _mm512_add_epi64(s, _mm512_mul_epu32(va, vb));
+    _mm512_storeu_si512((void *)(acc + i), s);
+  }
+  bi_mul_row_generic(acc + i, a + i, n - i, b);
+}
+
+__attribute__((target("avx512f")))
+static void bi_add_wide_avx512(bi_dlimb *acc, const bi_limb *a, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512i va = _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i *)(a + i)));
+    __m512i s = _mm512_loadu_si512((const void *)(acc + i));
+    _mm512_storeu_si512((void *)(acc + i), _mm512_add_epi64(s, va));
+  }
+  bi_add_wide_generic(acc + i, a + i, n - i);
+}
+
+static void bi_mul_avx512(bi_limb *r, const bi_limb *a, size_t an,
+                          const bi_limb *b, size_t bn) {
+  bi_mul_body(r, a, an, b, bn, bi_mul_row_avx512, 0);
+}
+
+static bi_limb bi_addmul_avx512(bi_limb *r, const bi_limb *a, size_t an,
+                              const bi_limb *b, size_t bn) {
+  return bi_mul_body(r, a, an, b, bn, bi_mul_row_avx512, 1);
+}
+
+static bi_limb bi_submul_avx512(bi_limb *r, const bi_limb *a, size_t an,
+                              const bi_limb *b, size_t bn) {
+  return bi_mul_body(r, a, an, b, bn, bi_mul_row_avx512, -1);
+}
+#endif
+
+// Runtime dispatch
+
+static const struct bi_kernels bi_kernels_table[] = {
+  { "generic", 0, bi_add_n_generic, bi_sub_n_generic, bi_mul_generic,
+    bi_addmul_generic, bi_submul_generic, bi_add_wide_generic,
+    bi_parse_generic, bi_format_generic },
+#if defined(BI_X86_KERNELS)
+  { "avx2", 1, bi_add_n_avx2, bi_sub_n_avx2, bi_mul_avx2,
+    bi_addmul_avx2, bi_submul_avx2, bi_add_wide_avx2,
+    bi_parse_avx2, bi_format_avx2 },
+  { "avx512", 2, bi_add_n_avx512, bi_sub_n_avx512, bi_mul_avx512,
+    bi_addmul_avx512, bi_submul_avx512, bi_add_wide_avx512,
+    bi_parse_avx2, bi_format_avx2 },
+#endif
+};
+
+#define BI_NKERNELS (sizeof(bi_kernels_table) / sizeof(bi_kernels_table[0]))
+
+// usable until the constructor below has run
+static const struct bi_kernels* bi_kernel = &bi_kernels_table[0];
+
+static bool bi_kernel_supported(int level) {
+#if defined(BI_X86_KERNELS)
+  __builtin_cpu_init();
+  if (level == 1)
+    return __builtin_cpu_supports("avx2");
+  if (level == 2)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("avx512f");
+#endif
+  return level == 0;
+}
+
+bool bi_kernel_select(const char *name) {
+  for (size_t i = 0; i < BI_NKERNELS; i++) {
+    const struct bi_kernels* k = &bi_kernels_table[i];
+    if (strcmp(k->name, name) == 0) {
+      if (!bi_kernel_supported(k->level))
+        return false;
+      __atomic_store_n(&bi_kernel, k, __ATOMIC_RELEASE);
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* bi_kernel_name(void) {
+  return bi_kern()->name;
+}
+
+__attribute__((constructor))
+static void bi_kernel_init(void) {
+  const char* forced = getenv("BI_KERNEL");
+  if (forced && bi_kernel_select(forced))
+    return;
+
+  for (size_t i = BI_NKERNELS; i-- > 0;) {
+    if (bi_kernel_supported(bi_kernels_table[i].level)) {
+      __atomic_store_n(&bi_kernel, &bi_kernels_table[i], __ATOMIC_RELEASE);
+      return;
+    }
+  }
+}
@@ -2,25 +2,64 @@
 #define BIGINT_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+// Limb representation, chosen at build time:
+//   default        base 10^9 in 32-bit limbs
+//   BI_LIMB_DEC18  base 10^18 in 64-bit limbs with 128-bit products
+//   BI_LIMB_BIN64  base 2^64 in 64-bit limbs; decimal strings are converted
+//                  when parsing and formatting
+#if defined(BI_LIMB_BIN64)
+#define BI_LIMB_NAME "bin64"
+#define BI_BINARY 1
+#define BI_LIMB_BITS 64
+#define BI_LIMB_MAX UINT64_MAX
+typedef uint64_t bi_limb;
+#elif defined(BI_LIMB_DEC18)
+#define BI_LIMB_NAME "dec18"
+#define BASE 1000000000000000000ULL
+#define BI_LIMB_DIGITS 18
+#define BI_LIMB_BITS 64
+#define BI_LIMB_MAX (BASE - 1)
+typedef uint64_t bi_limb;
+#else
+#define BI_LIMB_NAME "dec9"
 #define BASE 1000000000
+#define BI_LIMB_DIGITS 9
+#define BI_LIMB_BITS 32
+#define BI_LIMB_MAX (BASE - 1)
+typedef uint32_t bi_limb;
+#endif
 
 typedef struct bigint bigint;
 
 struct bigint {
   bool positive;
-  int digits;
+  int digits; // -1 until computed, use bi_digits() to read it
   int xlen;
-  int* x; // 222222222111111111 is stored as x->|11111111|222222222|
+  bi_limb* x; // 222222222111111111 is stored as x->|111111111|222222222|
+  char* str;  // decimal form, NULL until bi_tostring() caches it
 };
 
 bigint* bi_copy(const bigint *);
 bigint* bi_fromstring(const char *str);
 void bi_delete(bigint *);
 
+// Native numbers. bi_from_double truncates toward zero (exact for integral
+// values) and fails on NaN and infinities; bi_to_double rounds to nearest,
+// ties to even, giving +-HUGE_VAL beyond the double range. bi_to_i64 returns
+// false if a does not fit.
+bigint* bi_from_i64(int64_t);
+bigint* bi_from_u64(uint64_t);
+bigint* bi_from_double(double);
+bool bi_to_i64(const bigint *a, int64_t *v);
+double bi_to_double(const bigint *);
+
+int bi_digits(const bigint *);
 int bi_cmp(const bigint *, const bigint *);
 bool bi_equal(const bigint *, const bigint *);
 bool bi_is_zero(const bigint *);
@@ -33,11 +72,186 @@ bigint* bi_negate(const bigint *);
 bigint* bi_add(const bigint *, const bigint *);
 bigint* bi_sub(const bigint *, const bigint *);
 bigint* bi_mul(const bigint *, const bigint *);
+// c + a b and c - a b, with short products summed straight into the result
+bigint* bi_addmul(const bigint *c, const bigint *a, const bigint *b);
+bigint* bi_submul(const bigint *c, const bigint *a, const bigint *b);
 bigint* bi_div(const bigint *, const bigint *);
+// a / d when d is known to divide a; the result is meaningless otherwise
+bigint* bi_divexact(const bigint *a, const bigint *d);
+bigint* bi_pow(const bigint *, uint64_t);
+
+// Integer roots, rounded toward zero. bi_sqrtrem also stores a - s^2 in r
+// if given; both are NULL for a < 0, and so is bi_root(a, k) for k = 0 or
+// for a < 0 with even k.
+bigint* bi_sqrt(const bigint *);
+bigint* bi_sqrtrem(const bigint *a, bigint **r);
+bigint* bi_root(const bigint *a, uint64_t k);
+
+// Whether a = x^2, and whether a = x^k for some k >= 2 (so are 0, 1 and
+// -1); most other numbers are ruled out by residues without taking roots.
+bool bi_is_square(const bigint *);
+bool bi_is_perfect_power(const bigint *);
+
+// Greatest common divisors, always non-negative. bi_gcdext also stores
+// cofactors with s a + t b = gcd in s and t if given; bi_invert returns
+// a^-1 mod |m| in [0, |m|), NULL if a and m are not coprime.
+bigint* bi_gcd(const bigint *, const bigint *);
+bigint* bi_gcdext(const bigint *a, const bigint *b, bigint **s, bigint **t);
+bigint* bi_invert(const bigint *a, const bigint *m);
+
+// Machine-word operands, without building a bigint for them. bi_divmod_si
+// truncates like bi_div and stores the remainder (sign of a) in r if given.
+bigint* bi_add_si(const bigint *, int64_t);
+bigint* bi_sub_si(const bigint *, int64_t);
+bigint* bi_mul_si(const bigint *, int64_t);
+bigint* bi_divmod_si(const bigint *, int64_t, int64_t *r);
 
 bigint* bi_factorial(const bigint *);
 
+char* bi_tostring(const bigint *);
 void bi_print(const bigint *);
 
-#endif
+// Repeated division
+//
+// A bi_divisor precomputes what dividing by d needs: its scaled limbs and,
+// for long divisors, its reciprocal, so long quotients cost a few
+// multiplications. bi_divmod_by truncates like bi_div and stores the
+// remainder (sign of a) in r if given.
+typedef struct bi_divisor bi_divisor;
+
+bi_divisor* bi_divisor_new(const bigint *d);
+void bi_divisor_delete(bi_divisor *);
+bigint* bi_divmod_by(const bi_divisor *d, const bigint *a, bigint **r);
+
+// Batches
+//
+// r[i] = a[i] op b[i] for n independent pairs. All n results share one
+// allocation, released by bi_delete_n on the array as filled in, never by
+// bi_delete on single results. On a NULL operand or when out of memory the
+// batch returns false and r is left untouched.
+bool bi_add_n(bigint **r, bigint *const *a, bigint *const *b, size_t n);
+bool bi_sub_n(bigint **r, bigint *const *a, bigint *const *b, size_t n);
+bool bi_mul_n(bigint **r, bigint *const *a, bigint *const *b, size_t n);
+void bi_delete_n(bigint **r, size_t n);
+
+// Vectors
+//
+// A bi_vec holds n numbers of one width in structure-of-arrays form, limb i
+// of every number side by side, for element-wise operations that run
+// across the numbers in SIMD lanes. Sums are one limb wider than the wider
+// operand and products as wide as both; operands must hold the same count
+// of numbers. bi_vec_get converts element k back.
+typedef struct bi_vec bi_vec;
+
+bi_vec* bi_vec_new(bigint *const *a, size_t n);
+void bi_vec_delete(bi_vec *);
+size_t bi_vec_size(const bi_vec *);
+bigint* bi_vec_get(const bi_vec *, size_t k);
+bi_vec* bi_vec_add(const bi_vec *a, const bi_vec *b);
+bi_vec* bi_vec_sub(const bi_vec *a, const bi_vec *b);
+bi_vec* bi_vec_mul(const bi_vec *a, const bi_vec *b);
+
+// Threads and batches
+//
+// Parallel work runs on a process-wide pool of bi_threads() threads,
+// counting the caller, started on first use; the default is the number of
+// online CPUs and bi_threads_set changes it. A bi_batch collects operations
+// r = op(a, b), for op any of bi_add, bi_mul, bi_div, bi_gcd and the like,
+// and bi_batch_wait runs them all, balancing them over the pool by work
+// stealing. Operands must stay alive and unchanged until then. The wait
+// returns false if any result is NULL; the batch can then be reused.
+typedef struct bi_batch bi_batch;
 
+int bi_threads(void);
+void bi_threads_set(int threads);
+bi_batch* bi_batch_new(void);
+void bi_batch_delete(bi_batch *);
+bool bi_batch_submit(bi_batch *, bigint *(*op)(const bigint *, const bigint *),
+                     const bigint *a, const bigint *b, bigint **r);
+bool bi_batch_wait(bi_batch *);
+
+// Accumulation
+//
+// A bi_acc sums a stream of terms without normalizing after each one: limbs
+// are added into wider lanes and carried only when the lanes could
+// overflow, or when bi_acc_value reads the sum, which the accumulator keeps
+// adding to. bi_acc_add and bi_acc_sub return false on a NULL argument or
+// when out of memory.
+typedef struct bi_acc bi_acc;
+
+bi_acc* bi_acc_new(void);
+void bi_acc_delete(bi_acc *);
+bool bi_acc_add(bi_acc *, const bigint *a);
+bool bi_acc_sub(bi_acc *, const bigint *a);
+bigint* bi_acc_value(const bi_acc *);
+
+// Modular arithmetic
+//
+// A bi_modulus holds |m| with its precomputed reciprocal, so reducing a
+// product of two residues costs about two multiplications and no division.
+// Results are the least non-negative residues; bi_powmod builds a temporary
+// modulus, and both fail on a negative exponent or a zero modulus.
+typedef struct bi_modulus bi_modulus;
+
+bi_modulus* bi_modulus_new(const bigint *m);
+void bi_modulus_delete(bi_modulus *);
+bigint* bi_mod_by(const bi_modulus *, const bigint *a);
+bigint* bi_mulmod_by(const bi_modulus *, const bigint *a, const bigint *b);
+bigint* bi_powmod_by(const bi_modulus *, const bigint *a, const bigint *e);
+bigint* bi_powmod(const bigint *a, const bigint *e, const bigint *m);
+
+// Kernel dispatch
+//
+// The fastest kernels supported by the CPU are picked at startup. The
+// BI_KERNEL environment variable ("generic", "avx2", "avx512") or
+// bi_kernel_select() force a specific path; selection fails if the CPU
+// cannot run it.
+const char* bi_kernel_name(void);
+bool bi_kernel_select(const char *name);
+
+// Power cache
+//
+// The base 2^64 build converts decimal strings around powers of 10^19 and
+// their reciprocals. These are kept process-wide (thread-safe, up to
+// BI_POWCACHE_MAX_BYTES, 64 MiB by default) so later conversions reuse them.
+// bi_powcache_clear() releases them and bi_powcache_size() reports the bytes
+// held; the decimal builds cache nothing.
+void bi_powcache_clear(void);
+size_t bi_powcache_size(void);
+
+// Magnitude kernels
+//
+// These work on unsigned little-endian limb arrays in the limb base and never
+// allocate. Unless noted otherwise, an >= bn, r has room for an limbs and r
+// may alias a (but not b). The returned limb is the carry/borrow out of the
+// top limb.
+int bi_limbs_cmp(const bi_limb *a, size_t an, const bi_limb *b, size_t bn);
+size_t bi_limbs_normalize(const bi_limb *a, size_t n);
+
+bi_limb bi_limbs_add_1(bi_limb *r, const bi_limb *a, size_t n, bi_limb b);
+bi_limb bi_limbs_add_n(bi_limb *r, const bi_limb *a, const bi_limb *b, size_t n);
+bi_limb bi_limbs_add(bi_limb *r, const bi_limb *a, size_t an,
+                     const bi_limb *b, size_t bn);
+
+bi_limb bi_limbs_sub_1(bi_limb *r, const bi_limb *a, size_t n, bi_limb b);
+bi_limb bi_limbs_sub_n(bi_limb *r, const bi_limb *a, const bi_limb *b, size_t n);
+bi_limb bi_limbs_sub(bi_limb *r, const bi_limb *a, size_t an,
+                     const bi_limb *b, size_t bn);
+
+bi_limb bi_limbs_mul_1(bi_limb *r, const bi_limb *a, size_t n, bi_limb b);
+bi_limb bi_limbs_addmul_1(bi_limb *r, const bi_limb *a, size_t n, bi_limb b);
+// r -= a * b, returning the limb still to be subtracted above r[n - 1]
+bi_limb bi_limbs_submul_1(bi_limb *r, const bi_limb *a, size_t n, bi_limb b);
+// q = a / d, returning a % d; d must be non-zero and q may alias a
+bi_limb bi_limbs_divrem_1(bi_limb *q, const bi_limb *a, size_t n, bi_limb d);
+// r must hold an + bn limbs and must not overlap a or b
+void bi_limbs_mul(bi_limb *r, const bi_limb *a, size_t an,
+                  const bi_limb *b, size_t bn);
+// r += a b and r -= a b over the an + bn limbs of r, returning the carry or
+// borrow out of them; r must not overlap a or b
+bi_limb bi_limbs_addmul(bi_limb *r, const bi_limb *a, size_t an,
+                        const bi_limb *b, size_t bn);
+bi_limb bi_limbs_submul(bi_limb *r, const bi_limb *a, size_t an,
+                        const bi_limb *b, size_t bn);
+
+#endif
@@ -1,6 +1,10 @@
 #include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <time.h>
 #include "bigint.h"
 
 void test_bi_leading_zero();
@@ -10,10 +14,29 @@ void test_bi_cmp();
 void test_bi_add();
 void test_bi_sub();
 void test_bi_mul();
+void test_bi_addmul();
+void test_bi_acc();
+void test_bi_batch();
+void test_bi_vec();
+void test_bi_threads();
 void test_bi_div();
+void test_bi_divisor();
+void test_bi_divexact();
+void test_bi_pow();
+void test_bi_root();
+void test_bi_perfect_power();
+void test_bi_powmod();
+void test_bi_gcd();
+void test_bi_si();
+void test_bi_native();
 void test_bi_factorial();
 void test_bi_julia();
 void test_bi_julia_integrated();
+void test_bi_limbs();
+void test_bi_digits();
+void test_bi_tostring();
+void test_bi_kernels();
+void test_bi_powcache();
 void bi_assert(bigint* expected, bigint* actual);
 
 int main() {
@@ -22,16 +45,46 @@ int main() {
   test_bi_add();
   test_bi_sub();
   test_bi_mul();
+  test_bi_addmul();
+  test_bi_acc();
+  test_bi_batch();
+  test_bi_vec();
+  test_bi_threads();
   test_bi_div();
+  test_bi_divisor();
+  test_bi_divexact();
+  test_bi_pow();
+  test_bi_root();
+  test_bi_perfect_power();
+  test_bi_powmod();
+  test_bi_gcd();
+  test_bi_si();
+  test_bi_native();
   test_bi_factorial();
   test_bi_delete();
 
   test_bi_julia();
   test_bi_julia_integrated();
 
+  test_bi_limbs();
+  test_bi_digits();
+  test_bi_tostring();
+  test_bi_kernels();
+  test_bi_powcache();
+
   return 0;
 }
 
+// random number of the given length as a string, to be freed
+static char* random_digits(size_t digits) {
+  char* s = malloc(digits + 1);
+  s[0] = (char)('1' + rand() % 9);
+  for (size_t i = 1; i < digits; i++)
+    s[i] = (char)('0' + rand() % 10);
+  s[digits] = '\0';
+  return s;
+}
+
 void bi_assert(bigint* expected, bigint* actual) {
   int cmp = bi_cmp(expected, actual);
   if (cmp != 0) {
@@ -51,6 +104,40 @@ void test_bi_delete() {
 void test_bi_representation() {
   bigint* a;
 
+#if defined(BI_BINARY)
+  // 2^64 - 1 and 2^64
+  a = bi_fromstring("18446744073709551615");
+  assert (a->xlen == 1);
+  assert (a->digits == 20);
+  assert (a->x[0] == UINT64_MAX);
+  bi_delete(a);
+
+  a = bi_fromstring("-0018446744073709551616");
+  assert (a->xlen == 2);
+  assert (a->digits == 20);
+  assert (a->positive == 0);
+  assert (a->x[0] == 0 && a->x[1] == 1);
+  bi_delete(a);
+
+  a = bi_fromstring("000");
+  assert (a->xlen == 0);
+  assert (a->digits == 0);
+  assert (a->x == NULL);
+  bi_delete(a);
+#elif BI_LIMB_DIGITS == 18
+  a = bi_fromstring("999999999999999999");
+  assert (a->xlen == 1);
+  assert (a->digits == 18);
+  assert (a->x[0] == 999999999999999999ULL);
+  bi_delete(a);
+
+  a = bi_fromstring("-0001000000000000000000012");
+  assert (a->xlen == 2);
+  assert (a->digits == 22);
+  assert (a->positive == 0);
+  assert (a->x[0] == 12 && a->x[1] == 1000);
+  bi_delete(a);
+#else
   // zero
   a = bi_fromstring("0");
   assert (a->xlen == 0);
@@ -119,6 +206,7 @@ void test_bi_representation() {
   assert (a->x != NULL);
   assert (a->x[0] == 1U);
   bi_delete(a);
+#endif
 
   puts("test_bi_representation: OK");
 }
@@ -703,13 +791,1073 @@ void test_bi_mul() {
   bi_delete(c);
   bi_delete(expected);
 
+  // Karatsuba, balanced and piecewise, against the long multiplication kernel
+  size_t sizes[][2] = { {900, 900}, {3000, 2900}, {5000, 1200}, {6000, 400} };
+  for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+    char* sa = random_digits(sizes[k][0]);
+    char* sb = random_digits(sizes[k][1]);
+    a = bi_fromstring(sa);
+    b = bi_fromstring(sb);
+    c = bi_mul(a, b);
+    bi_limb* r = malloc((a->xlen + b->xlen) * sizeof(bi_limb));
+    bi_limbs_mul(r, a->x, a->xlen, b->x, b->xlen);
+    size_t rn = bi_limbs_normalize(r, a->xlen + b->xlen);
+    assert (rn == (size_t)c->xlen);
+    assert (memcmp(r, c->x, rn * sizeof(bi_limb)) == 0);
+    free(r);
+    free(sa);
+    free(sb);
+    bi_delete(a);
+    bi_delete(b);
+    bi_delete(c);
+  }
+
   puts("test_bi_mul: OK");
 }
 
+void test_bi_addmul() {
+  struct { const char* c; const char* a; const char* b;
+           const char* sum; const char* diff; } cases[] = {
+    { "0", "12345678901234567890", "-3",
+      "-37037036703703703670", "37037036703703703670" },
+    { "100", "0", "5", "100", "100" },
+    { "-58024690835802468754", "1234567890123456782", "47",
+      "0", "-116049381671604937508" },
+    { "1", "999999999999999999999999999", "999999999999999999999999999",
+      "999999999999999999999999998000000000000000000000000002",
+      "-999999999999999999999999998000000000000000000000000000" },
+    { "123456789012345678901234567890123456789012345678901234567890",
+      "-98765432109876543210", "12345",
+      "123456789012345678901234567890123455569753086282475308640440",
+      "123456789012345678901234567890123458008271605075327160495340" },
+    { "-1", "-1", "-1", "0", "-2" },
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    bigint* c = bi_fromstring(cases[i].c);
+    bigint* a = bi_fromstring(cases[i].a);
+    bigint* b = bi_fromstring(cases[i].b);
+    bigint* expected = bi_fromstring(cases[i].sum);
+    bigint* r = bi_addmul(c, a, b);
+    bi_assert(expected, r);
+    bi_delete(r);
+    bi_delete(expected);
+    expected = bi_fromstring(cases[i].diff);
+    r = bi_submul(c, a, b);
+    bi_assert(expected, r);
+    bi_delete(r);
+    bi_delete(expected);
+    bi_delete(b);
+    bi_delete(a);
+    bi_delete(c);
+  }
+
+  // against bi_mul and bi_add, with c about as long as the product, far
+  // longer, and close to it in either sign so the result wraps
+  size_t sizes[][3] = { {30, 20, 50}, {200, 90, 2000}, {400, 400, 800},
+                        {3000, 2900, 100} };
+  for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+    char* sa = random_digits(sizes[k][0]);
+    char* sb = random_digits(sizes[k][1]);
+    char* sc = random_digits(sizes[k][2]);
+    bigint* a = bi_fromstring(sa);
+    bigint* b = bi_fromstring(sb);
+    bigint* p = bi_mul(a, b);
+    bigint* cs[] = { bi_fromstring(sc), bi_negate(p), bi_sub_si(p, 1) };
+    for (size_t j = 0; j < 3; j++) {
+      bigint* expected = bi_add(cs[j], p);
+      bigint* r = bi_addmul(cs[j], a, b);
+      bi_assert(expected, r);
+      bi_delete(r);
+      bi_delete(expected);
+      expected = bi_sub(cs[j], p);
+      r = bi_submul(cs[j], a, b);
+      bi_assert(expected, r);
+      bi_delete(r);
+      bi_delete(expected);
+      bi_delete(cs[j]);
+    }
+    free(sa);
+    free(sb);
+    free(sc);
+    bi_delete(p);
+    bi_delete(b);
+    bi_delete(a);
+  }
+  assert (bi_addmul(NULL, NULL, NULL) == NULL);
+
+  puts("test_bi_addmul: OK");
+}
+
+void test_bi_acc() {
+  bi_acc* acc = bi_acc_new();
+  bigint* zero = bi_acc_value(acc);
+  assert (bi_is_zero(zero));
+  bi_delete(zero);
+
+  // terms of mixed lengths and signs against a running bi_add
+  bigint* expected = bi_zero();
+  for (int i = 0; i < 300; i++) {
+    size_t length = (size_t)(1 + rand() % (i % 50 == 0 ? 2000 : 40));
+    char* digits = random_digits(length);
+    bigint* a = bi_fromstring(digits);
+    free(digits);
+    bool sub = rand() % 2;
+    bigint* b = rand() % 3 == 0 ? bi_negate(a) : bi_copy(a);
+    assert (sub ? bi_acc_sub(acc, b) : bi_acc_add(acc, b));
+    bigint* next = sub ? bi_sub(expected, b) : bi_add(expected, b);
+    bi_delete(expected);
+    expected = next;
+    bi_delete(b);
+    bi_delete(a);
+
+    // reading the value does not disturb the sum
+    if (i % 100 == 99) {
+      bigint* value = bi_acc_value(acc);
+      bi_assert(expected, value);
+      bi_delete(value);
+    }
+  }
+
+  // everything taken back out again
+  bigint* value = bi_acc_value(acc);
+  assert (bi_acc_sub(acc, value));
+  bi_delete(value);
+  value = bi_acc_value(acc);
+  assert (bi_is_zero(value));
+  bi_delete(value);
+  bi_delete(expected);
+
+  assert (!bi_acc_add(acc, NULL));
+  assert (bi_acc_value(NULL) == NULL);
+  bi_acc_delete(acc);
+
+  puts("test_bi_acc: OK");
+}
+
+void test_bi_batch() {
+  // short and long operands, zeros, equal magnitudes and mixed signs
+  enum { N = 40 };
+  bigint* a[N];
+  bigint* b[N];
+  bigint* r[N];
+  for (int i = 0; i < N; i++) {
+    char* digits = random_digits(i % 10 == 0 ? 1500 : (size_t)(1 + i * 3));
+    a[i] = i % 13 == 0 ? bi_zero() : bi_fromstring(digits);
+    free(digits);
+    digits = random_digits(i % 7 == 0 ? 1200 : (size_t)(1 + rand() % 60));
+    b[i] = i % 11 == 0 ? bi_zero() :
+           i % 5 == 0 ? bi_negate(a[i]) : bi_fromstring(digits);
+    free(digits);
+    if (i % 3 == 0) {
+      bigint* negative = bi_negate(b[i]);
+      bi_delete(b[i]);
+      b[i] = negative;
+    }
+  }
+
+  bool (*batch[])(bigint **, bigint *const *, bigint *const *, size_t) = {
+    bi_add_n, bi_sub_n, bi_mul_n };
+  bigint* (*single[])(const bigint *, const bigint *) = {
+    bi_add, bi_sub, bi_mul };
+  for (int k = 0; k < 3; k++) {
+    assert (batch[k](r, a, b, N));
+    for (int i = 0; i < N; i++) {
+      bigint* expected = single[k](a[i], b[i]);
+      bi_assert(expected, r[i]);
+      assert (expected->xlen == r[i]->xlen);
+      char* s = bi_tostring(expected);
+      char* t = bi_tostring(r[i]);
+      assert (strcmp(s, t) == 0);
+      free(s);
+      free(t);
+      bi_delete(expected);
+    }
+    bi_delete_n(r, N);
+  }
+
+  bigint* hole = b[N / 2];
+  b[N / 2] = NULL;
+  r[0] = NULL;
+  assert (!bi_mul_n(r, a, b, N));
+  assert (r[0] == NULL);
+  assert (bi_add_n(r, a, b, 0));
+  b[N / 2] = hole;
+
+  for (int i = 0; i < N; i++) {
+    bi_delete(a[i]);
+    bi_delete(b[i]);
+  }
+
+  puts("test_bi_batch: OK");
+}
+
+void test_bi_vec() {
+  // a count that leaves padding lanes, mixed lengths, zeros and signs, and
+  // pairs that cancel
+  enum { N = 21 };
+  bigint* a[N];
+  bigint* b[N];
+  for (int i = 0; i < N; i++) {
+    char* digits = random_digits(i % 8 == 0 ? 400 : (size_t)(1 + rand() % 50));
+    a[i] = i % 9 == 0 ? bi_zero() : bi_fromstring(digits);
+    free(digits);
+    digits = random_digits((size_t)(1 + rand() % 50));
+    b[i] = i % 10 == 0 ? bi_zero() :
+           i % 4 == 0 ? bi_copy(a[i]) : bi_fromstring(digits);
+    free(digits);
+    if (i % 3 == 0) {
+      bigint* negative = bi_negate(b[i]);
+      bi_delete(b[i]);
+      b[i] = negative;
+    }
+  }
+
+  bi_vec* va = bi_vec_new(a, N);
+  bi_vec* vb = bi_vec_new(b, N);
+  assert (bi_vec_size(va) == N);
+  bi_vec* (*vector[])(const bi_vec *, const bi_vec *) = {
+    bi_vec_add, bi_vec_sub, bi_vec_mul };
+  bigint* (*single[])(const bigint *, const bigint *) = {
+    bi_add, bi_sub, bi_mul };
+  for (int k = 0; k < 3; k++) {
+    bi_vec* vr = vector[k](va, vb);
+    for (int i = 0; i < N; i++) {
+      bigint* expected = single[k](a[i], b[i]);
+      bigint* r = bi_vec_get(vr, i);
+      bi_assert(expected, r);
+      assert (expected->positive == r->positive);
+      bi_delete(r);
+      bi_delete(expected);
+    }
+    assert (bi_vec_get(vr, N) == NULL);
+    bi_vec_delete(vr);
+  }
+
+  // operands of different counts
+  bi_vec* shorter = bi_vec_new(a, N - 1);
+  assert (bi_vec_add(va, shorter) == NULL);
+  bi_vec_delete(shorter);
+
+  bi_vec_delete(va);
+  bi_vec_delete(vb);
+  for (int i = 0; i < N; i++) {
+    bi_delete(a[i]);
+    bi_delete(b[i]);
+  }
+
+  puts("test_bi_vec: OK");
+}
+
+// a*a + b*b, with a batch of its own, to run batches from pool threads
+static bigint* squares_sum(const bigint *a, const bigint *b) {
+  bigint* aa;
+  bigint* bb;
+  bi_batch* batch = bi_batch_new();
+  bi_batch_submit(batch, bi_mul, a, a, &aa);
+  bi_batch_submit(batch, bi_mul, b, b, &bb);
+  assert (bi_batch_wait(batch));
+  bi_batch_delete(batch);
+  bigint* r = bi_add(aa, bb);
+  bi_delete(aa);
+  bi_delete(bb);
+  return r;
+}
+
+void test_bi_threads() {
+  int threads = bi_threads();
+  assert (threads >= 1);
+  bi_threads_set(4);
+  assert (bi_threads() == 4);
+
+  // long multiplications among many short additions, so that ranges are
+  // split and stolen
+  enum { N = 600 };
+  bigint* a[N];
+  bigint* b[N];
+  bigint* r[N];
+  bigint* (*op[])(const bigint *, const bigint *) = {
+    bi_add, bi_sub, bi_mul, bi_div, squares_sum };
+  bi_batch* batch = bi_batch_new();
+  for (int round = 0; round < 2; round++) {
+    for (int i = 0; i < N; i++) {
+      bool long_mul = i % 50 == 7;
+      char* digits = random_digits(long_mul ? 20000 : (size_t)(1 + rand() % 60));
+      a[i] = bi_fromstring(digits);
+      free(digits);
+      digits = random_digits(long_mul ? 15000 : (size_t)(1 + rand() % 30));
+      b[i] = bi_fromstring(digits);
+      free(digits);
+      assert (bi_batch_submit(batch, long_mul ? bi_mul : op[i % 5],
+                              a[i], b[i], &r[i]));
+    }
+    assert (bi_batch_wait(batch));
+    for (int i = 0; i < N; i++) {
+      bigint* expected = (i % 50 == 7 ? bi_mul : op[i % 5])(a[i], b[i]);
+      bi_assert(expected, r[i]);
+      bi_delete(expected);
+      bi_delete(r[i]);
+      bi_delete(a[i]);
+      bi_delete(b[i]);
+    }
+  }
+
+  // a NULL result fails the wait, and the others are still computed
+  bigint* zero = bi_zero();
+  bigint* one = bi_fromstring("1");
+  bigint* q;
+  bigint* sum;
+  assert (bi_batch_submit(batch, bi_div, one, zero, &q));
+  assert (bi_batch_submit(batch, bi_add, one, one, &sum));
+  assert (!bi_batch_wait(batch));
+  assert (q == NULL);
+  bigint* two = bi_fromstring("2");
+  bi_assert(two, sum);
+  bi_delete(two);
+  assert (bi_batch_wait(batch));
+  bi_delete(sum);
+  bi_delete(one);
+  bi_delete(zero);
+  bi_batch_delete(batch);
+
+  // Karatsuba products and squares split over the pool, balanced and not
+  size_t sizes[][2] = { { 40000, 40000 }, { 40000, 39000 }, { 90000, 12000 } };
+  for (int k = 0; k < 3; k++) {
+    char* digits = random_digits(sizes[k][0]);
+    bigint* x = bi_fromstring(digits);
+    free(digits);
+    digits = random_digits(sizes[k][1]);
+    bigint* y = bi_fromstring(digits);
+    free(digits);
+    bi_threads_set(1);
+    bigint* expected = bi_mul(x, y);
+    bigint* expected_sqr = bi_mul(x, x);
+    bi_threads_set(4);
+    bigint* product = bi_mul(y, x);
+    bigint* sqr = bi_mul(x, x);
+    bi_assert(expected, product);
+    bi_assert(expected_sqr, sqr);
+    bi_delete(product);
+    bi_delete(sqr);
+    bi_delete(expected);
+    bi_delete(expected_sqr);
+    bi_delete(x);
+    bi_delete(y);
+  }
+
+  bi_threads_set(threads);
+  puts("test_bi_threads: OK");
+}
+
 void test_bi_div() {
+  const char* cases[][3] = {
+    { "7", "2", "3" }, { "-7", "2", "-3" }, { "7", "-2", "-3" },
+    { "-7", "-2", "3" }, { "1", "2", "0" }, { "-1", "2", "0" },
+    { "0", "5", "0" }, { "999999999999999999", "999999999", "1000000001" },
+    { "1000000000000000000000000000000", "1000000000", "1000000000000000000000" },
+    { "123456789012345678901234567890", "9876543210987654321", "12499999886" },
+    { "340282366920938463463374607431768211456", "18446744073709551615",
+      "18446744073709551617" }
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    bigint* a = bi_fromstring(cases[i][0]);
+    bigint* b = bi_fromstring(cases[i][1]);
+    bigint* c = bi_div(a, b);
+    bigint* expected = bi_fromstring(cases[i][2]);
+    bi_assert(expected, c);
+    bi_delete(a);
+    bi_delete(b);
+    bi_delete(c);
+    bi_delete(expected);
+  }
+
+  // division by zero
+  bigint* a = bi_fromstring("1");
+  bigint* b = bi_zero();
+  assert (bi_div(a, b) == NULL);
+  bi_delete(a);
+  bi_delete(b);
+
+  // 0 <= a - q b < b, with schoolbook and reciprocal quotients
+  size_t sizes[][2] = { {40, 20}, {700, 300}, {3000, 800}, {5000, 2600},
+                        {12000, 6000}, {9000, 30} };
+  for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+    char* sa = random_digits(sizes[k][0]);
+    char* sb = random_digits(sizes[k][1]);
+    a = bi_fromstring(sa);
+    b = bi_fromstring(sb);
+    bigint* q = bi_div(a, b);
+    bigint* qb = bi_mul(q, b);
+    bigint* r = bi_sub(a, qb);
+    assert (r->positive && bi_cmp(r, b) < 0);
+
+    // exact quotients
+    bigint* back = bi_div(qb, q);
+    bi_assert(b, back);
+    bi_delete(back);
+    free(sa);
+    free(sb);
+    bi_delete(a);
+    bi_delete(b);
+    bi_delete(q);
+    bi_delete(qb);
+    bi_delete(r);
+  }
+
   puts("test_bi_div: OK");
 }
 
+void test_bi_divisor() {
+  assert (bi_divisor_new(NULL) == NULL);
+  bigint* zero = bi_zero();
+  assert (bi_divisor_new(zero) == NULL);
+  bi_delete(zero);
+
+  bigint* a = bi_fromstring("-123456789012345678901234567890");
+  bigint* d = bi_fromstring("9876543210");
+  bi_divisor* div = bi_divisor_new(d);
+  bigint* r;
+  bigint* q = bi_divmod_by(div, a, &r);
+  bigint* expected = bi_fromstring("-12499999887343749990");
+  bi_assert(expected, q);
+  bi_delete(expected);
+  expected = bi_fromstring("-1562499990");
+  bi_assert(expected, r);
+  bi_delete(expected);
+  bi_delete(q);
+  bi_delete(r);
+  bi_divisor_delete(div);
+  bi_delete(d);
+  bi_delete(a);
+
+  // one divisor of each length for many dividends, checked as a = q d + r
+  size_t lengths[] = { 1, 15, 200, 1200 };
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    char* digits = random_digits(lengths[i]);
+    d = bi_fromstring(digits);
+    free(digits);
+    div = bi_divisor_new(d);
+    for (int k = 0; k < 8; k++) {
+      digits = random_digits(lengths[i] + (size_t)rand() % (2 * lengths[i] + 10));
+      a = bi_fromstring(digits);
+      free(digits);
+      if (k % 2) {
+        bigint* neg = bi_negate(a);
+        bi_delete(a);
+        a = neg;
+      }
+
+      q = bi_divmod_by(div, a, &r);
+      bigint* expected_q = bi_div(a, d);
+      bi_assert(expected_q, q);
+      bigint* qd = bi_mul(q, d);
+      bigint* back = bi_add(qd, r);
+      bi_assert(a, back);
+      assert (bi_is_zero(r) || r->positive == a->positive);
+      bi_delete(expected_q);
+      bi_delete(qd);
+      bi_delete(back);
+      bi_delete(q);
+      bi_delete(r);
+      bi_delete(a);
+    }
+    bi_divisor_delete(div);
+    bi_delete(d);
+  }
+
+  puts("test_bi_divisor: OK");
+}
+
+void test_bi_divexact() {
+  struct { const char* a; const char* d; const char* q; } cases[] = {
+    { "0", "-7", "0" },
+    { "-91", "7", "-13" },
+    { "121932631137021795226185032733622923332237463801111263526900",
+      "-987654321098765432109876543210", "-123456789012345678901234567890" },
+    // powers of 2 and 5 and zero limbs shared by a and d
+    { "-4722366482869645213696000000000000",
+      "-1180591620717411303424000000000000", "4" },
+    { "36893488147419103232000000000000000000", "1220703125",
+      "30223145490365729367654400000" },
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    bigint* a = bi_fromstring(cases[i].a);
+    bigint* d = bi_fromstring(cases[i].d);
+    bigint* q = bi_divexact(a, d);
+    char* s = bi_tostring(q);
+    assert (strcmp(s, cases[i].q) == 0);
+    free(s);
+    bi_delete(q);
+    bi_delete(a);
+    bi_delete(d);
+  }
+
+  bigint* a = bi_from_i64(10);
+  bigint* zero = bi_zero();
+  assert (bi_divexact(a, zero) == NULL);
+  assert (bi_divexact(NULL, a) == NULL);
+  bi_delete(zero);
+  bi_delete(a);
+
+  // products q d of both quotient paths give q back
+  size_t lengths[][2] = {
+    { 3, 40 }, { 200, 15 }, { 150, 900 }, { 2500, 1300 },
+  };
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    char* digits = random_digits(lengths[i][0]);
+    bigint* q = bi_fromstring(digits);
+    free(digits);
+    digits = random_digits(lengths[i][1]);
+    bigint* d = bi_fromstring(digits);
+    free(digits);
+    a = bi_mul(q, d);
+    bigint* r = bi_divexact(a, d);
+    bi_assert(q, r);
+    bi_delete(r);
+    bi_delete(a);
+    bi_delete(q);
+    bi_delete(d);
+  }
+
+  puts("test_bi_divexact: OK");
+}
+
+void test_bi_pow() {
+  struct { const char* a; uint64_t n; const char* pow; } cases[] = {
+    { "0", 0, "1" }, { "0", 5, "0" }, { "-1", 7, "-1" }, { "-1", 8, "1" },
+    { "-3", 5, "-243" }, { "12345678901234567890", 1, "12345678901234567890" },
+    { "999999999", 3, "999999997000000002999999999" },
+    { "-1000", 7, "-1000000000000000000000" },
+    { "1000000000000000000", 2, "1000000000000000000000000000000000000" },
+    { "18446744073709551616", 3,
+      "6277101735386680763835789423207666416102355444464034512896" },
+    { "-2", 65, "-36893488147419103232" },
+    { "123456789", 11, "1015464508224831631192750210084208815363165935360"
+                       "32018296854662965892684042512235805234189" },
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    bigint* a = bi_fromstring(cases[i].a);
+    bigint* p = bi_pow(a, cases[i].n);
+    char* s = bi_tostring(p);
+    assert (strcmp(s, cases[i].pow) == 0);
+    free(s);
+    bi_delete(p);
+    bi_delete(a);
+  }
+
+  // results that cannot be held
+  bigint* a = bi_from_i64(3);
+  assert (bi_pow(a, UINT64_MAX) == NULL);
+  bi_delete(a);
+  a = bi_from_i64(-100);
+  assert (bi_pow(a, (uint64_t)1 << 40) == NULL);
+  bi_delete(a);
+  assert (bi_pow(NULL, 2) == NULL);
+
+  // windows and Karatsuba squaring against repeated multiplication
+  uint64_t exponents[] = { 2, 7, 100, 1025 };
+  size_t lengths[] = { 5, 40, 300 };
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    char* digits = random_digits(lengths[i]);
+    a = bi_fromstring(digits);
+    free(digits);
+    for (size_t j = 0; j < sizeof(exponents) / sizeof(exponents[0]); j++) {
+      uint64_t n = exponents[j];
+      if (lengths[i] * n > 40000)
+        continue;
+      bigint* expected = bi_copy(a);
+      for (uint64_t k = 1; k < n; k++) {
+        bigint* next = bi_mul(expected, a);
+        bi_delete(expected);
+        expected = next;
+      }
+      bigint* p = bi_pow(a, n);
+      bi_assert(expected, p);
+      bi_delete(p);
+      bi_delete(expected);
+    }
+    bi_delete(a);
+  }
+
+  puts("test_bi_pow: OK");
+}
+
+void test_bi_root() {
+  struct { const char* a; const char* s; const char* r; } squares[] = {
+    { "0", "0", "0" }, { "1", "1", "0" }, { "8", "2", "4" },
+    { "99999999999999999999", "9999999999", "19999999998" },
+    { "1000000000000000000000000000000000000", "1000000000000000000", "0" },
+    { "340282366920938463463374607431768211455", "18446744073709551615",
+      "36893488147419103230" },
+    { "12345678901234567890123456789012345678901234567890",
+      "3513641828820144253111222", "2682313349501674532234606" },
+  };
+  for (size_t i = 0; i < sizeof(squares) / sizeof(squares[0]); i++) {
+    bigint* a = bi_fromstring(squares[i].a);
+    bigint* expected = bi_fromstring(squares[i].s);
+    bigint* rem = bi_fromstring(squares[i].r);
+    bigint* r;
+    bigint* s = bi_sqrtrem(a, &r);
+    bi_assert(expected, s);
+    bi_assert(rem, r);
+    bi_delete(s);
+    s = bi_sqrt(a);
+    bi_assert(expected, s);
+    bi_delete(s);
+    bi_delete(r);
+    bi_delete(rem);
+    bi_delete(expected);
+    bi_delete(a);
+  }
+
+  struct { const char* a; uint64_t k; const char* root; } roots[] = {
+    { "-1000000000000000000000000000000", 3, "-10000000000" },
+    { "100000000000000000000000000000000000000000000000000", 7, "13894954" },
+    { "1606938044258990275541962092341162602522202993782792835301381", 5,
+      "1099511627776" },
+    { "-7", 1, "-7" }, { "123", 100, "1" }, { "-5", ((uint64_t)1 << 40) + 1, "-1" },
+  };
+  for (size_t i = 0; i < sizeof(roots) / sizeof(roots[0]); i++) {
+    bigint* a = bi_fromstring(roots[i].a);
+    bigint* expected = bi_fromstring(roots[i].root);
+    bigint* r = bi_root(a, roots[i].k);
+    bi_assert(expected, r);
+    bi_delete(r);
+    bi_delete(expected);
+    bi_delete(a);
+  }
+  bigint* minus = bi_from_i64(-4);
+  assert (bi_sqrt(minus) == NULL);
+  assert (bi_root(minus, 4) == NULL);
+  assert (bi_root(minus, 0) == NULL);
+  bi_delete(minus);
+
+  // x^k and x^k - 1 for long x, through the recursive paths
+  uint64_t degrees[] = { 2, 3, 10 };
+  size_t lengths[] = { 30, 400, 3000 };
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    char* digits = random_digits(lengths[i]);
+    bigint* x = bi_fromstring(digits);
+    free(digits);
+    bigint* below = bi_sub_si(x, 1);
+    for (size_t j = 0; j < sizeof(degrees) / sizeof(degrees[0]); j++) {
+      bigint* p = bi_pow(x, degrees[j]);
+      bigint* q = bi_sub_si(p, 1);
+      bigint* r = bi_root(p, degrees[j]);
+      bi_assert(x, r);
+      bi_delete(r);
+      r = bi_root(q, degrees[j]);
+      bi_assert(below, r);
+      bi_delete(r);
+      bi_delete(p);
+      bi_delete(q);
+    }
+
+    // s^2 + r = a with 0 <= r <= 2s
+    bigint* a = bi_mul(x, below);
+    bigint* r;
+    bigint* s = bi_sqrtrem(a, &r);
+    bi_assert(below, s);
+    bi_assert(below, r);
+    bi_delete(s);
+    bi_delete(r);
+    bi_delete(a);
+    bi_delete(below);
+    bi_delete(x);
+  }
+
+  puts("test_bi_root: OK");
+}
+
+void test_bi_perfect_power() {
+  struct { const char* a; bool square; bool power; } cases[] = {
+    { "0", true, true }, { "1", true, true }, { "-1", false, true },
+    { "2", false, false }, { "4", true, true }, { "8", false, true },
+    { "-8", false, true }, { "-4", false, false }, { "12", false, false },
+    { "1000000000", false, true }, { "1000000000000000000", true, true },
+    { "18446744073709551616", true, true },
+    { "36893488147419103232", false, true },
+    { "57295631137754295811667225357", false, true },
+    { "57295631137754295811667225358", false, false },
+    { "340282366920938463463374607431768211456", true, true },
+    { "340282366920938463463374607431768211455", false, false },
+    { "-1606938044258990275541962092341162602522202993782792835301376",
+      false, true },
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    bigint* a = bi_fromstring(cases[i].a);
+    assert (bi_is_square(a) == cases[i].square);
+    assert (bi_is_perfect_power(a) == cases[i].power);
+    bi_delete(a);
+  }
+
+  // x^k and x^k + 1 for long x, and a power of 3 with a prime exponent
+  // past the double estimate
+  uint64_t degrees[] = { 2, 3, 5, 9 };
+  char* digits = random_digits(200);
+  bigint* x = bi_fromstring(digits);
+  free(digits);
+  for (size_t j = 0; j < sizeof(degrees) / sizeof(degrees[0]); j++) {
+    bigint* p = bi_pow(x, degrees[j]);
+    bigint* q = bi_add_si(p, 1);
+    assert (bi_is_square(p) == (degrees[j] == 2));
+    assert (bi_is_perfect_power(p));
+    assert (!bi_is_square(q));
+    assert (!bi_is_perfect_power(q));
+    bi_delete(q);
+    bi_delete(p);
+  }
+  bi_delete(x);
+  bigint* three = bi_from_i64(3);
+  bigint* p = bi_pow(three, 1009);
+  bigint* q = bi_sub_si(p, 1);
+  assert (bi_is_perfect_power(p));
+  assert (!bi_is_perfect_power(q));
+  bi_delete(q);
+  bi_delete(p);
+  bi_delete(three);
+
+  // a long odd number is turned down in a few cube roots' time, though for
+  // hundreds of exponents k near log2 a, 2^(log2(a) / k) is close to whole
+  digits = random_digits(60000);
+  digits[59999] = '7';
+  bigint* a = bi_fromstring(digits);
+  free(digits);
+  clock_t start = clock();
+  bigint* root = bi_root(a, 3);
+  clock_t root_time = clock() - start;
+  start = clock();
+  assert (!bi_is_perfect_power(a));
+  clock_t power_time = clock() - start;
+  assert (power_time <= 8 * root_time + CLOCKS_PER_SEC / 50);
+  bi_delete(root);
+  bi_delete(a);
+
+  puts("test_bi_perfect_power: OK");
+}
+
+void test_bi_powmod() {
+  struct { const char* a; const char* e; const char* m; const char* r; } cases[] = {
+    { "4", "13", "497", "445" },
+    { "-7", "3", "-10", "7" },
+    { "5", "0", "1", "0" },
+    { "0", "0", "7", "1" },
+    { "3", "1267650600228229401496703205376", "10000000000000000000000000000000000000007",
+      "6319037181700904539233379754738973482705" },
+    // Fermat's little theorem for the Mersenne prime 2^127 - 1
+    { "123456789123456789", "170141183460469231731687303715884105726",
+      "170141183460469231731687303715884105727", "1" },
+    { "2", "-1", "7", NULL },
+    { "2", "5", "0", NULL },
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    bigint* a = bi_fromstring(cases[i].a);
+    bigint* e = bi_fromstring(cases[i].e);
+    bigint* m = bi_fromstring(cases[i].m);
+    bigint* r = bi_powmod(a, e, m);
+    if (!cases[i].r)
+      assert (r == NULL);
+    else {
+      char* s = bi_tostring(r);
+      assert (strcmp(s, cases[i].r) == 0);
+      free(s);
+    }
+    bi_delete(r);
+    bi_delete(a);
+    bi_delete(e);
+    bi_delete(m);
+  }
+
+  // one modulus for several operations
+  bigint* m = bi_fromstring("1000000000000000000000000000057");
+  bi_modulus* mod = bi_modulus_new(m);
+  bigint* a = bi_fromstring("1388407934307049329820719251686807205688469485076800680207982");
+  bigint* b = bi_fromstring("418826683484414654864196446");
+  bigint* r = bi_mulmod_by(mod, a, b);
+  bigint* expected = bi_fromstring("159876270287275428694599256779");
+  bi_assert(expected, r);
+  bi_delete(r);
+  bi_delete(expected);
+  bigint* na = bi_negate(a);
+  r = bi_mod_by(mod, na);
+  expected = bi_fromstring("332046567032326722980317133674");
+  bi_assert(expected, r);
+  bi_delete(r);
+  bi_delete(expected);
+  bi_delete(na);
+  bi_delete(a);
+  bi_delete(b);
+  bi_modulus_delete(mod);
+  bi_delete(m);
+
+  assert (bi_modulus_new(NULL) == NULL);
+  bigint* zero = bi_zero();
+  assert (bi_modulus_new(zero) == NULL);
+  bi_delete(zero);
+
+  puts("test_bi_powmod: OK");
+}
+
+void test_bi_gcd() {
+  struct { const char* a; const char* b; const char* g; } cases[] = {
+    { "0", "0", "0" },
+    { "0", "-15", "15" },
+    { "-12", "18", "6" },
+    { "1606938044258990275541962092341162602522202993782792835301375",
+      "1797010299914431210413179829509605039731475627537851106401", "3" },
+    { "-1197530853419753085341975308533", "-9580246914658024691465739", "291" },
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    bigint* a = bi_fromstring(cases[i].a);
+    bigint* b = bi_fromstring(cases[i].b);
+    bigint* expected = bi_fromstring(cases[i].g);
+    bigint* g = bi_gcd(a, b);
+    bi_assert(expected, g);
+    bi_delete(g);
+
+    // s a + t b = g
+    bigint* s;
+    bigint* t;
+    g = bi_gcdext(a, b, &s, &t);
+    bi_assert(expected, g);
+    bigint* sa = bi_mul(s, a);
+    bigint* tb = bi_mul(t, b);
+    bigint* sum = bi_add(sa, tb);
+    bi_assert(expected, sum);
+    bi_delete(sa);
+    bi_delete(tb);
+    bi_delete(sum);
+    bi_delete(s);
+    bi_delete(t);
+    bi_delete(g);
+    bi_delete(expected);
+    bi_delete(a);
+    bi_delete(b);
+  }
+
+  // long operands sharing a known factor
+  char* digits = random_digits(3000);
+  bigint* f = bi_fromstring(digits);
+  free(digits);
+  digits = random_digits(5000);
+  bigint* p = bi_fromstring(digits);
+  free(digits);
+  bigint* q = bi_add_si(p, 1);
+  bigint* a = bi_mul(f, p);
+  bigint* b = bi_mul(f, q);
+  bigint* g = bi_gcd(a, b);
+  bi_assert(f, g);
+  bi_delete(g);
+  bi_delete(a);
+  bi_delete(b);
+  bi_delete(f);
+  bi_delete(p);
+  bi_delete(q);
+
+  // gcd(F(m), F(n)) = F(gcd(m, n)) for Fibonacci numbers, whose quotients
+  // are all 1; F(24000) has 5016 digits
+  bigint* fib[3] = { NULL, NULL, NULL };
+  bigint* x = bi_zero();
+  bigint* y = bi_from_i64(1);
+  for (int n = 1; n <= 24000; n++) {
+    bigint* z = bi_add(x, y);
+    bi_delete(x);
+    x = y;
+    y = z;
+    if (n == 6000)
+      fib[0] = bi_copy(x);
+    if (n == 18000)
+      fib[1] = bi_copy(x);
+  }
+  fib[2] = x;
+  g = bi_gcd(fib[2], fib[1]);
+  bi_assert(fib[0], g);
+  bi_delete(g);
+  bigint* s;
+  bigint* t;
+  g = bi_gcdext(fib[2], y, &s, &t);
+  assert (bi_is_one(g));
+  bigint* sa = bi_mul(s, fib[2]);
+  bigint* tb = bi_mul(t, y);
+  bigint* sum = bi_add(sa, tb);
+  assert (bi_is_one(sum));
+  bi_delete(sa);
+  bi_delete(tb);
+  bi_delete(sum);
+  bi_delete(s);
+  bi_delete(t);
+  bi_delete(g);
+  bi_delete(y);
+  for (int i = 0; i < 3; i++)
+    bi_delete(fib[i]);
+
+  bigint* three = bi_from_i64(3);
+  bigint* m = bi_fromstring("1000000000000000000000000000057");
+  bigint* inv = bi_invert(three, m);
+  bigint* expected = bi_fromstring("666666666666666666666666666705");
+  bi_assert(expected, inv);
+  bi_delete(expected);
+  bi_delete(inv);
+  bigint* six = bi_from_i64(-6);
+  bigint* nine = bi_from_i64(9);
+  assert (bi_invert(six, nine) == NULL);
+  inv = bi_invert(six, m);
+  bi_modulus* mod = bi_modulus_new(m);
+  bigint* check = bi_mulmod_by(mod, inv, six);
+  assert (bi_is_one(check));
+  bi_delete(check);
+  bi_modulus_delete(mod);
+  bi_delete(inv);
+  bi_delete(six);
+  bi_delete(nine);
+  bi_delete(three);
+  bi_delete(m);
+
+  puts("test_bi_gcd: OK");
+}
+
+void test_bi_si() {
+  struct { const char* a; int64_t b; const char* sum; const char* diff;
+           const char* prod; const char* quot; int64_t rem; } cases[] = {
+    { "0", 5, "5", "-5", "0", "0", 0 },
+    { "17", 0, "17", "17", "0", NULL, 0 },
+    { "999999999999999999", 1, "1000000000000000000", "999999999999999998",
+      "999999999999999999", "999999999999999999", 0 },
+    { "-1000000000", 999999999, "-1", "-1999999999", "-999999999000000000",
+      "-1", -1 },
+    { "123456789012345678901234567890", -7,
+      "123456789012345678901234567883", "123456789012345678901234567897",
+      "-864197523086419752308641975230", "-17636684144620811271604938270", 0 },
+    { "-36893488147419103232", INT64_MIN, "-46116860184273879040",
+      "-27670116110564327424", "340282366920938463463374607431768211456",
+      "4", 0 },
+    { "100000000000000000000000000001", INT64_MAX,
+      "100000000009223372036854775808", "99999999990776627963145224194",
+      "922337203685477580700000000009223372036854775807", "10842021724",
+      7886392067356368733 },
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    bigint* a = bi_fromstring(cases[i].a);
+    const char* expected[] = { cases[i].sum, cases[i].diff, cases[i].prod };
+    bigint* results[] = { bi_add_si(a, cases[i].b), bi_sub_si(a, cases[i].b),
+                          bi_mul_si(a, cases[i].b) };
+    for (int k = 0; k < 3; k++) {
+      char* s = bi_tostring(results[k]);
+      assert (strcmp(s, expected[k]) == 0);
+      free(s);
+      bi_delete(results[k]);
+    }
+
+    int64_t rem = 42;
+    bigint* q = bi_divmod_si(a, cases[i].b, &rem);
+    if (!cases[i].quot)
+      assert (q == NULL);
+    else {
+      char* s = bi_tostring(q);
+      assert (strcmp(s, cases[i].quot) == 0);
+      assert (rem == cases[i].rem);
+      free(s);
+    }
+    bi_delete(q);
+    bi_delete(a);
+  }
+
+  puts("test_bi_si: OK");
+}
+
+void test_bi_native() {
+  struct { int64_t v; const char* s; } ints[] = {
+    { 0, "0" }, { -1, "-1" }, { 1000000000, "1000000000" },
+    { INT64_MAX, "9223372036854775807" }, { INT64_MIN, "-9223372036854775808" },
+  };
+  for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+    bigint* a = bi_from_i64(ints[i].v);
+    char* s = bi_tostring(a);
+    assert (strcmp(s, ints[i].s) == 0);
+    int64_t v = 42;
+    assert (bi_to_i64(a, &v) && v == ints[i].v);
+    free(s);
+    bi_delete(a);
+  }
+
+  bigint* a = bi_from_u64(UINT64_MAX);
+  char* s = bi_tostring(a);
+  assert (strcmp(s, "18446744073709551615") == 0);
+  assert (!bi_to_i64(a, NULL));
+  free(s);
+  bi_delete(a);
+
+  // just outside the int64_t range
+  const char* overflow[] = { "9223372036854775808", "-9223372036854775809",
+                             "100000000000000000000000000000" };
+  for (size_t i = 0; i < sizeof(overflow) / sizeof(overflow[0]); i++) {
+    a = bi_fromstring(overflow[i]);
+    assert (!bi_to_i64(a, NULL));
+    bi_delete(a);
+  }
+
+  struct { double d; const char* s; } doubles[] = {
+    { 0.0, "0" }, { -0.0, "0" }, { -2.5e-3, "0" }, { 123456789.987, "123456789" },
+    { -9007199254740993.0, "-9007199254740992" },
+    { 1e300, "1000000000000000052504760255204420248704468581108159154915854115"
+             "511802457988908195786371375080447864043704443832883878176942523"
+             "235360430575644792184786706982848387200926575803737830233794788"
+             "090059368953234970799945081119038967640880074652742780142494579"
+             "258788820056842838115669472196386865459400540160" },
+  };
+  for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++) {
+    a = bi_from_double(doubles[i].d);
+    s = bi_tostring(a);
+    assert (strcmp(s, doubles[i].s) == 0);
+    free(s);
+    bi_delete(a);
+  }
+  assert (bi_from_double(NAN) == NULL);
+  assert (bi_from_double(-INFINITY) == NULL);
+
+  // round to nearest, ties to even, with bits far below the last place
+  struct { const char* s; double d; } rounding[] = {
+    { "9007199254740993", 9007199254740992.0 },
+    { "9007199254740995", 9007199254740996.0 },
+    { "-11417981541647680316116887983825362587765178368",
+      -9007199254740992.0 * 1267650600228229401496703205376.0 },
+    { "11417981541647680316116887983825362587765178369",
+      9007199254740994.0 * 1267650600228229401496703205376.0 },
+    { "1" "000000000000000000000000000000000000000000000000000000000000000000"
+      "000000000000000000000000000000000000000000000000000000000000000000000"
+      "000000000000000000000000000000000000000000000000000000000000000000000"
+      "000000000000000000000000000000000000000000000000000000000000000000000"
+      "0000000000000000000000000000000000000", HUGE_VAL },
+    // half an ulp above DBL_MAX: just below stays, the tie goes to infinity
+    { "1797693134862315807937289714053034150799341327100378269361737789"
+      "8044496829276475094664901797758720709633028641669288791094655554"
+      "7851940402630657488671505820681908902000708383676273854845817711"
+      "5317644757302700698555713669596228429148198608349364752927190741"
+      "68444365510704342711559699508093042880177904174497791",
+      DBL_MAX },
+    { "1797693134862315807937289714053034150799341327100378269361737789"
+      "8044496829276475094664901797758720709633028641669288791094655554"
+      "7851940402630657488671505820681908902000708383676273854845817711"
+      "5317644757302700698555713669596228429148198608349364752927190741"
+      "68444365510704342711559699508093042880177904174497792",
+      HUGE_VAL },
+  };
+  for (size_t i = 0; i < sizeof(rounding) / sizeof(rounding[0]); i++) {
+    a = bi_fromstring(rounding[i].s);
+    assert (bi_to_double(a) == rounding[i].d);
+    bi_delete(a);
+  }
+
+  // doubles survive the round trip, including the largest one
+  double values[] = { 1.0, -4503599627370497.0, 1e22, 1e300, -DBL_MAX };
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    a = bi_from_double(values[i]);
+    assert (bi_to_double(a) == values[i]);
+    bi_delete(a);
+  }
+
+  puts("test_bi_native: OK");
+}
+
 void test_bi_factorial() {
   bigint* a;
   bigint* b;
@@ -934,3 +2082,358 @@ void test_bi_julia_integrated() {
 
   puts("test_bi_julia_integrated: OK");
 }
+
+void test_bi_limbs() {
+  const bi_limb m = BI_LIMB_MAX;
+  bi_limb a[3] = {m, m, 5};
+  bi_limb b[2] = {1, m};
+  bi_limb r[4];
+
+  // add with carry through every limb
+  assert (bi_limbs_add(r, a, 3, b, 2) == 0);
+  assert (r[0] == 0 && r[1] == m && r[2] == 6);
+
+  // subtract with borrow
+  assert (bi_limbs_sub(r, a, 3, b, 2) == 0);
+  assert (r[0] == m - 1 && r[1] == 0 && r[2] == 5);
+  assert (bi_limbs_sub_n(r, b, a, 2) == 1);
+
+  // single limb operations
+  assert (bi_limbs_add_1(r, a, 2, 1) == 1);
+  assert (r[0] == 0 && r[1] == 0);
+  assert (bi_limbs_sub_1(r, r, 2, 1) == 1);
+  assert (r[0] == m && r[1] == m);
+  assert (bi_limbs_mul_1(r, a, 3, 2) == 0);
+  assert (r[0] == m - 1 && r[1] == m && r[2] == 11);
+
+  // (B^2 - 1) * (B^2 - 1) = B^4 - 2 * B^2 + 1
+  bi_limb c[2] = {m, m};
+  bi_limbs_mul(r, c, 2, c, 2);
+  assert (r[0] == 1 && r[1] == 0 && r[2] == m - 1 && r[3] == m);
+
+  assert (bi_limbs_cmp(a, 3, b, 2) == 1);
+  assert (bi_limbs_cmp(b, 2, a, 3) == -1);
+  assert (bi_limbs_cmp(c, 2, c, 2) == 0);
+  bi_limb z[3] = {7, 0, 0};
+  assert (bi_limbs_normalize(z, 3) == 1);
+
+#if defined(BI_BINARY)
+  assert (bi_limbs_divrem_1(r, c, 2, 10) == 5);
+  assert (r[0] == 0x9999999999999999ULL && r[1] == 0x1999999999999999ULL);
+#else
+  // (6 * B^2 - 1) / 1000
+  assert (bi_limbs_divrem_1(r, a, 3, 1000) == 999);
+  assert (r[0] == m && r[1] == 6 * (BASE / 1000) - 1 && r[2] == 0);
+#endif
+
+  puts("test_bi_limbs: OK");
+}
+
+void test_bi_digits() {
+  bigint* a;
+  bigint* b;
+  bigint* c;
+
+  a = bi_fromstring("0");
+  assert (bi_digits(a) == 0);
+  bi_delete(a);
+
+  // digits of arithmetic results are computed on demand
+  a = bi_fromstring("999999999");
+  b = bi_fromstring("1");
+  c = bi_add(a, b);
+  assert (c->digits == -1);
+  assert (bi_digits(c) == 10);
+#if defined(BI_BINARY)
+  // only the base 2^64 build needs to cache the count
+  assert (c->digits == 10);
+#endif
+  bi_delete(c);
+
+  c = bi_sub(a, b);
+  assert (bi_digits(c) == 9);
+  bi_delete(c);
+  bi_delete(b);
+
+  b = bi_fromstring("-1000000000000000000000");
+  c = bi_mul(a, b);
+  assert (bi_digits(c) == 30);
+  bi_delete(c);
+  c = bi_sub(a, a);
+  assert (bi_digits(c) == 0);
+  bi_delete(a);
+  bi_delete(b);
+  bi_delete(c);
+
+  for (int i = 1; i <= 9; i++) {
+    char s[10] = "100000000";
+    s[i] = '\0';
+    a = bi_fromstring(s);
+    b = bi_add(a, a);
+    c = bi_sub(b, a);
+    assert (bi_digits(c) == i);
+    bi_delete(a);
+    bi_delete(b);
+    bi_delete(c);
+  }
+
+  puts("test_bi_digits: OK");
+}
+
+static void* shared_tostring(void *a) {
+  return bi_tostring(a);
+}
+
+void test_bi_tostring() {
+  const char* cases[] = {
+    "0", "1", "-1", "999999999", "1000000000", "-1000000000000000001",
+    "123456789012345678901234567890", "-100000000000000000000000000000000000"
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    bigint* a = bi_fromstring(cases[i]);
+    char* s = bi_tostring(a);
+    assert (strcmp(s, cases[i]) == 0);
+    free(s);
+    bi_delete(a);
+  }
+
+  bigint* a = bi_fromstring("-000123");
+  char* s = bi_tostring(a);
+  assert (strcmp(s, "-123") == 0);
+  free(s);
+  bi_delete(a);
+
+  // long enough to split around powers of the chunk base
+  char* digits = random_digits(30000);
+  for (int i = 1000; i < 1400; i++)
+    digits[i] = '0';
+  a = bi_fromstring(digits);
+  bigint* twice = bi_add(a, a);
+  bigint* half = bi_sub(twice, a);
+  s = bi_tostring(half);
+  assert (strcmp(s, digits) == 0);
+  free(s);
+  free(digits);
+  bi_delete(a);
+  bi_delete(twice);
+  bi_delete(half);
+
+  // the decimal form is kept after the first call, not when parsed or copied
+  a = bi_fromstring("-12345678901234567890123456789");
+  assert (a->str == NULL);
+  bigint* b = bi_mul(a, a);
+  assert (b->str == NULL);
+  s = bi_tostring(b);
+  assert (b->str != NULL && b->str != s);
+  assert (strcmp(s, "152415787532388367504953515625361987875019051998750190521") == 0);
+  bigint* c = bi_copy(b);
+  assert (c->str == NULL);
+  char* t = bi_tostring(c);
+  assert (strcmp(s, t) == 0);
+  free(s);
+  free(t);
+  bi_delete(c);
+
+  // results that start as copies of an operand get their own sign
+  c = bi_fromstring("-1");
+  bigint* d = bi_mul(b, c);
+  t = bi_tostring(d);
+  assert (t[0] == '-' && strcmp(t + 1, b->str) == 0);
+  free(t);
+  bi_delete(d);
+  d = bi_zero();
+  bi_delete(c);
+  c = bi_sub(d, b);
+  t = bi_tostring(c);
+  assert (t[0] == '-' && strcmp(t + 1, b->str) == 0);
+  free(t);
+  bi_delete(a);
+  bi_delete(b);
+  bi_delete(c);
+  bi_delete(d);
+
+  // threads formatting one bigint at once agree on its cached form
+  digits = random_digits(3000);
+  a = bi_fromstring(digits);
+  b = bi_add(a, a);
+  pthread_t threads[4];
+  for (int i = 0; i < 4; i++)
+    assert (pthread_create(&threads[i], NULL, shared_tostring, b) == 0);
+  for (int i = 0; i < 4; i++) {
+    void* result;
+    assert (pthread_join(threads[i], &result) == 0);
+    assert (strcmp(result, b->str) == 0);
+    free(result);
+  }
+  free(digits);
+  bi_delete(a);
+  bi_delete(b);
+
+  puts("test_bi_tostring: OK");
+}
+
+#if BI_LIMB_BITS == 64
+typedef unsigned __int128 wide_limb;
+#else
+typedef uint64_t wide_limb;
+#endif
+#if defined(BI_BINARY)
+#define LIMB_BASE ((wide_limb)1 << 64)
+#else
+#define LIMB_BASE ((wide_limb)BASE)
+#endif
+
+static bi_limb random_limb() {
+  bi_limb v = 0;
+  for (int i = 0; i < 4; i++)
+    v = (bi_limb)(((wide_limb)v << 16 | (rand() & 0xffff)) % LIMB_BASE);
+  return v;
+}
+
+static void check_kernels() {
+  bi_limb x[520], y[520], s[1040], t[1040];
+
+  // long carry and borrow chains, checked against a plain ripple loop
+  for (int round = 0; round < 200; round++) {
+    for (int i = 0; i < 67; i++) {
+      int kind = rand() % 4;
+      x[i] = kind == 0 ? BI_LIMB_MAX : kind == 1 ? 0 : random_limb();
+      kind = rand() % 4;
+      y[i] = kind == 0 ? BI_LIMB_MAX : kind == 1 ? 0 : random_limb();
+    }
+
+    wide_limb carry = 0;
+    bi_limb out = bi_limbs_add_n(s, x, y, 67);
+    for (int i = 0; i < 67; i++) {
+      carry += (wide_limb)x[i] + y[i];
+      assert (s[i] == (bi_limb)(carry % LIMB_BASE));
+      carry /= LIMB_BASE;
+    }
+    assert (out == (bi_limb)carry);
+
+    wide_limb borrow = 0;
+    out = bi_limbs_sub_n(s, x, y, 67);
+    for (int i = 0; i < 67; i++) {
+      wide_limb diff = LIMB_BASE + x[i] - y[i] - borrow;
+      borrow = diff < LIMB_BASE;
+      assert (s[i] == (bi_limb)(diff % LIMB_BASE));
+    }
+    assert (out == (bi_limb)borrow);
+
+    // q * d + r gives back the dividend
+    bi_limb d = random_limb() >> (rand() % BI_LIMB_BITS);
+    d += d == 0;
+    bi_limb rem = bi_limbs_divrem_1(s, x, 67, d);
+    assert (rem < d);
+    bi_limbs_mul_1(t, s, 67, d);
+    bi_limbs_add_1(t, t, 67, rem);
+    assert (memcmp(t, x, 67 * sizeof(bi_limb)) == 0);
+  }
+
+  // multiplication against row-by-row addmul_1, across block boundaries
+  int sizes[][2] = { {1, 1}, {5, 3}, {17, 17}, {40, 33}, {300, 20}, {513, 40} };
+  for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+    int an = sizes[k][0];
+    int bn = sizes[k][1];
+    for (int i = 0; i < an; i++)
+      x[i] = rand() % 3 ? BI_LIMB_MAX : random_limb();
+    for (int i = 0; i < bn; i++)
+      y[i] = rand() % 3 ? BI_LIMB_MAX : random_limb();
+
+    bi_limbs_mul(s, x, an, y, bn);
+    memset(t, 0, sizeof(t));
+    for (int j = 0; j < bn; j++)
+      t[j + an] = bi_limbs_addmul_1(t + j, x, an, y[j]);
+    assert (memcmp(s, t, (an + bn) * sizeof(bi_limb)) == 0);
+  }
+
+  // wide lanes through an accumulator: copies of x sum to a multiple
+  for (int i = 0; i < 67; i++)
+    x[i] = rand() % 3 ? BI_LIMB_MAX : random_limb();
+  bigint view = { true, -1, 67, x, NULL };
+  bi_acc* acc = bi_acc_new();
+  for (int i = 0; i < 1000; i++)
+    assert (bi_acc_add(acc, &view));
+  bigint* sum = bi_acc_value(acc);
+  bigint* expected = bi_mul_si(&view, 1000);
+  bi_assert(expected, sum);
+  bi_delete(expected);
+  bi_delete(sum);
+  bi_acc_delete(acc);
+
+  // parse and format round trip
+  char str[400];
+  for (int len = 1; len < 300; len += 7) {
+    str[0] = (char)('1' + rand() % 9);
+    for (int i = 1; i < len; i++)
+      str[i] = (char)('0' + rand() % 10);
+    str[len] = '\0';
+    bigint* a = bi_fromstring(str);
+    char* back = bi_tostring(a);
+    assert (strcmp(str, back) == 0);
+    free(back);
+    bi_delete(a);
+  }
+}
+
+void test_bi_kernels() {
+  const char* names[] = { "generic", "avx2", "avx512" };
+  const char* selected = bi_kernel_name();
+
+  assert (!bi_kernel_select("no-such-kernel"));
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    if (!bi_kernel_select(names[i]))
+      continue;
+    assert (strcmp(bi_kernel_name(), names[i]) == 0);
+    check_kernels();
+  }
+  assert (bi_kernel_select(selected));
+
+  puts("test_bi_kernels: OK");
+}
+
+// parse, then format a computed copy so the string cache is not used
+static void* round_trip(void *digits) {
+  bigint* a = bi_fromstring(digits);
+  bigint* twice = bi_add(a, a);
+  bigint* half = bi_sub(twice, a);
+  char* s = bi_tostring(half);
+  bool ok = strcmp(s, digits) == 0;
+  free(s);
+  bi_delete(a);
+  bi_delete(twice);
+  bi_delete(half);
+  return ok ? digits : NULL;
+}
+
+void test_bi_powcache() {
+  char* digits = random_digits(20000);
+  bi_powcache_clear();
+  assert (bi_powcache_size() == 0);
+
+  // conversions running at once share the cache as it grows
+  pthread_t threads[4];
+  for (int i = 0; i < 4; i++)
+    assert (pthread_create(&threads[i], NULL, round_trip, digits) == 0);
+  for (int i = 0; i < 4; i++) {
+    void* result;
+    assert (pthread_join(threads[i], &result) == 0);
+    assert (result == digits);
+  }
+
+  size_t size = bi_powcache_size();
+#if defined(BI_BINARY)
+  assert (size > 0);
+#else
+  assert (size == 0);
+#endif
+  assert (round_trip(digits) == digits);
+  assert (bi_powcache_size() == size);
+
+  bi_powcache_clear();
+  assert (bi_powcache_size() == 0);
+  assert (round_trip(digits) == digits);
+  free(digits);
+
+  puts("test_bi_powcache: OK");
+}